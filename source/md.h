@@ -4,6 +4,7 @@
 // NOTE(allen): "Plugin" functionality
 //
 // MD_b32     MD_IMPL_FileIterIncrement(MD_FileIter*, MD_String8, MD_FileInfo*) - optional
+// MD_String8 MD_IMPL_MapEntireFile(MD_String8)                                 - optional
 // void*      MD_IMPL_Alloc(MD_u64)                                             - required
 //
 
@@ -397,6 +398,10 @@ enum
     MD_NodeFlag_StringLiteral           = (1<<16),
 };
 
+typedef struct MD_UnexpandedSet MD_UnexpandedSet;
+typedef struct MD_StructuralIndex MD_StructuralIndex;
+typedef struct MD_NodeAccel MD_NodeAccel;
+
 typedef struct MD_Node MD_Node;
 struct MD_Node
 {
@@ -411,6 +416,26 @@ struct MD_Node
     MD_Node *first_tag;
     MD_Node *last_tag;
     
+    // Position in the sibling list, and list lengths. Maintained by the parser,
+    // MD_PushChild, MD_PushTag, MD_RemoveChild, and MD_RemoveTag, but not by
+    // the MD_NodeDbl* list macros.
+    MD_u64 index;
+    MD_u64 child_count;
+    MD_u64 tag_count;
+    
+    // Bloom filter of the strings of the node's tags, for rejecting tag
+    // lookups without walking the list. Maintained with tag_count.
+    MD_u64 tag_bloom;
+    
+    // Dense identifier, assigned when the node is made; zero for the nil node.
+    // Used to key MD_NodeTable.
+    MD_u32 id;
+    
+    // Cached result of MD_NodeStructuralHash, with 1 + the match flags that it
+    // was computed for; zero when there is none.
+    MD_u32 structural_hash_key;
+    MD_u64 structural_hash;
+    
     // Node info.
     MD_NodeKind kind;
     MD_NodeFlags flags;
@@ -422,11 +447,19 @@ struct MD_Node
     MD_String8 prev_comment;
     MD_String8 next_comment;
     
-    // Source code location information.
+    // Source code location information. The end is one past the node's last
+    // byte, after its children and closing delimiter.
     MD_u64 offset;
+    MD_u64 end_offset;
     
     // Reference.
     MD_Node *ref_target;
+    
+    // Deferred children, for sets skipped by a lazy parse.
+    MD_UnexpandedSet *unexpanded;
+    
+    // Lookup structures built on demand. Not copied with the node.
+    MD_NodeAccel *accel;
 };
 
 //~ Code Location Info.
@@ -439,6 +472,13 @@ struct MD_CodeLoc
     MD_u32 column;
 };
 
+typedef MD_u32 MD_CodeLocFlags;
+enum
+{
+    // Count columns in code points rather than bytes, treating the file as UTF-8.
+    MD_CodeLocFlag_CodepointColumns = (1<<0),
+};
+
 //~ String-To-Ptr and Ptr-To-Ptr tables
 
 typedef struct MD_MapKey MD_MapKey;
@@ -471,6 +511,51 @@ struct MD_Map
     MD_u64 bucket_count;
 };
 
+//~ Node Side Tables
+
+#define MD_NODE_TABLE_PAGE_SIZE 4096
+
+typedef struct MD_NodeTable MD_NodeTable;
+struct MD_NodeTable
+{
+    MD_u64 value_size;
+    // Page i holds the values for IDs [i*MD_NODE_TABLE_PAGE_SIZE, (i+1)*MD_NODE_TABLE_PAGE_SIZE),
+    // and is null until one of them is written.
+    MD_u8 **pages;
+    MD_u64 page_count;
+};
+
+//~ Node Arrays
+
+typedef struct MD_NodeArray MD_NodeArray;
+struct MD_NodeArray
+{
+    MD_Node **v;
+    MD_u64 count;
+    MD_u64 cap;
+};
+
+typedef MD_u64 MD_NodeKeyFunction(MD_Node *node, void *user_data);
+typedef MD_String8 MD_NodeStringKeyFunction(MD_Node *node, void *user_data);
+typedef MD_b32 MD_NodeFilterFunction(MD_Node *node, void *user_data);
+
+//~ Tree-Wide Indexes
+
+typedef struct MD_Index MD_Index;
+struct MD_Index
+{
+    // Each maps a string to an MD_NodeArray *, holding nodes in document order.
+    MD_Map tag_map;
+    MD_Map string_map;
+    
+    // Orders nodes from different trees, by when each tree was first indexed.
+    MD_Map root_rank_map;
+    MD_u64 root_count;
+    
+    // Lazily parsed sets whose children had not been indexed when last checked.
+    MD_NodeArray unexpanded;
+};
+
 //~ Tokens
 
 typedef MD_u32 MD_TokenKind;
@@ -507,6 +592,14 @@ enum
                              MD_TokenKind_BadCharacter),
 };
 
+typedef MD_u32 MD_LexFlags;
+enum
+{
+    // Lex valid UTF-8 code points as single characters, and allow non-ASCII
+    // letters in identifiers. Otherwise, every byte >= 0x80 is a bad character.
+    MD_LexFlag_UTF8 = (1<<0),
+};
+
 typedef struct MD_Token MD_Token;
 struct MD_Token
 {
@@ -516,6 +609,26 @@ struct MD_Token
     MD_String8 raw_string;
 };
 
+//~ Structural Index
+
+struct MD_StructuralIndex
+{
+    // Offsets of every reserved symbol, newline, string literal, and comment
+    // in a string, in order. Strings and comments are indexed by their first
+    // byte, and their contents are not indexed.
+    MD_u64 count;
+    MD_u64 *offsets;
+    
+    // For each entry, the index of the entry holding the matching delimiter,
+    // or the entry's own index if it is not a matched delimiter.
+    MD_u64 *partners;
+    
+    // For each entry, one past the last byte of its token, and the token's
+    // kind, as the lexer would produce them at the entry's offset.
+    MD_u64 *ends;
+    MD_TokenKind *kinds;
+};
+
 //~ Parsing State
 
 typedef enum MD_MessageKind
@@ -555,6 +668,51 @@ typedef enum MD_ParseSetRule
 }
 MD_ParseSetRule;
 
+typedef MD_u32 MD_ParseFlags;
+enum
+{
+    MD_ParseFlag_LazySets     = (1<<0),
+    MD_ParseFlag_SkipComments = (1<<1),
+    MD_ParseFlag_SkipTags     = (1<<2),
+    MD_ParseFlag_TerseErrors  = (1<<3),
+    MD_ParseFlag_UTF8         = (1<<4),
+};
+
+typedef struct MD_ParseOptions MD_ParseOptions;
+struct MD_ParseOptions
+{
+    MD_ParseFlags flags;
+    
+    // Directory for cached binary trees, used by MD_ParseWholeFileWithOptions.
+    // No caching is done when empty.
+    MD_String8 cache_dir;
+
+    // Limits for parsing untrusted input; zero means unlimited. When one is
+    // exceeded, parsing stops with a catastrophic error, and the result holds
+    // the tree parsed so far. Limits apply per call; lazily parsed sets are
+    // limited again when expanded.
+    MD_u64 max_depth;
+    MD_u64 max_node_count;
+    MD_u64 max_byte_count;
+    MD_u64 max_step_count;
+
+    // Errors past this count are not built, and are replaced by a single
+    // note; zero means unlimited.
+    MD_u64 max_error_count;
+
+    // When set, every parsed node is added to this index as it is built.
+    MD_Index *index;
+};
+
+struct MD_UnexpandedSet
+{
+    MD_String8 contents;
+    MD_u64 offset;
+    MD_ParseOptions options;
+    MD_StructuralIndex *index;
+    MD_b32 read_index;
+};
+
 typedef struct MD_ParseResult MD_ParseResult;
 struct MD_ParseResult
 {
@@ -565,6 +723,177 @@ struct MD_ParseResult
     MD_MessageList errors;
 };
 
+typedef enum MD_ParseEventKind
+{
+    MD_ParseEventKind_BeginNode,
+    MD_ParseEventKind_Tag,
+    MD_ParseEventKind_BeginSet,
+    MD_ParseEventKind_EndSet,
+    MD_ParseEventKind_Comment,
+    MD_ParseEventKind_Error,
+}
+MD_ParseEventKind;
+
+typedef struct MD_ParseEvent MD_ParseEvent;
+struct MD_ParseEvent
+{
+    MD_ParseEventKind kind;
+    
+    // Number of sets enclosing the node; 0 for top-level nodes.
+    MD_u64 depth;
+    
+    // The node being begun, tagged, or delimited, or the node an error refers
+    // to. Only valid for the duration of the callback; nil for comments.
+    MD_Node *node;
+    
+    MD_String8 string;
+    MD_u64 offset;
+    MD_Message *message;
+};
+
+typedef void MD_ParseEventCallback(MD_ParseEvent *event, void *user_data);
+
+//~ Selectors
+
+typedef enum MD_SelectorOpKind
+{
+    MD_SelectorOpKind_Null,
+    // Begin a step; its candidates are the children of the last step's match.
+    MD_SelectorOpKind_Child,
+    // Begin a step; its candidates are all descendants of the last step's match.
+    MD_SelectorOpKind_Descendant,
+    // Tests on a step's candidates.
+    MD_SelectorOpKind_Name,
+    MD_SelectorOpKind_HasTag,
+    MD_SelectorOpKind_LacksTag,
+}
+MD_SelectorOpKind;
+
+typedef struct MD_SelectorOp MD_SelectorOp;
+struct MD_SelectorOp
+{
+    MD_SelectorOpKind kind;
+    MD_String8 string;
+};
+
+#define MD_SELECTOR_MAX_STEPS 64
+
+typedef struct MD_Selector MD_Selector;
+struct MD_Selector
+{
+    MD_SelectorOp *ops;
+    MD_u64 op_count;
+    MD_u64 *step_op_indices;
+    MD_u64 step_count;
+    MD_MessageList errors;
+};
+
+//~ Frozen Trees
+
+// A read-only copy of a tree, laid out in preorder as a set of arrays. Each
+// node's subtree is the range [i, i + subtree_sizes[i]); its tags come first,
+// then its children. Indices of zero mean "none", except for the root's
+// parent, which is the root.
+typedef struct MD_FrozenTree MD_FrozenTree;
+struct MD_FrozenTree
+{
+    MD_u64 count;
+    MD_u8 *kinds;
+    MD_NodeFlags *flags;
+    MD_u32 *subtree_sizes;
+    MD_u32 *parents;
+    MD_u32 *next_siblings;
+    MD_u32 *first_children;
+    MD_u32 *child_counts;
+    MD_u32 *tag_counts;
+    MD_u64 *offsets;
+    
+    // Node strings, packed into one blob.
+    MD_u64 *string_offsets;
+    MD_u64 *string_sizes;
+    MD_u8 *blob;
+    MD_u64 blob_size;
+    
+    // The nodes that were frozen, for everything else.
+    MD_Node **nodes;
+};
+
+//~ Tree Diffs
+
+typedef enum MD_TreeEditKind
+{
+    MD_TreeEditKind_Insert,
+    MD_TreeEditKind_Delete,
+    MD_TreeEditKind_Update,
+    MD_TreeEditKind_Move,
+}
+MD_TreeEditKind;
+
+typedef struct MD_TreeEdit MD_TreeEdit;
+struct MD_TreeEdit
+{
+    MD_TreeEdit *next;
+    MD_TreeEditKind kind;
+    // Nil for inserts.
+    MD_Node *old_node;
+    // Nil for deletes.
+    MD_Node *new_node;
+};
+
+typedef struct MD_TreeEditList MD_TreeEditList;
+struct MD_TreeEditList
+{
+    MD_TreeEdit *first;
+    MD_TreeEdit *last;
+    MD_u64 node_count;
+};
+
+//~ Hot Reload
+
+typedef struct MD_HotReloadVersion MD_HotReloadVersion;
+struct MD_HotReloadVersion
+{
+    MD_HotReloadVersion *next;
+    MD_ParseResult parse;
+    MD_String8 contents;
+    // The epoch in which this version was replaced; it is retired when no
+    // reader is still in that epoch or an earlier one.
+    MD_u64 retire_epoch;
+};
+
+typedef void MD_HotReloadRetireCallback(MD_HotReloadVersion *version, void *user_data);
+
+// NOTE: One per reading thread, padded to a cache line so that readers
+// do not contend for each other's slots.
+typedef struct MD_HotReloadReader MD_HotReloadReader;
+struct MD_HotReloadReader
+{
+    // The epoch the reader entered in, or zero outside of reads.
+    volatile MD_u64 epoch;
+    MD_u8 padding[56];
+};
+
+typedef struct MD_HotReload MD_HotReload;
+struct MD_HotReload
+{
+    MD_String8 filename;
+    MD_ParseOptions options;
+    
+    // Called by the reloading thread for each replaced version once no
+    // reader can see it any longer.
+    MD_HotReloadRetireCallback *retire_callback;
+    void *retire_user_data;
+    
+    MD_HotReloadVersion *volatile current;
+    volatile MD_u64 epoch;
+    MD_HotReloadReader *readers;
+    MD_u64 reader_count;
+    
+    // Only touched by the reloading thread.
+    MD_HotReloadVersion *first_retired;
+    MD_MessageList errors;
+};
+
 //~ Command line parsing helper types.
 
 typedef struct MD_CmdLineOption MD_CmdLineOption;
@@ -650,6 +979,14 @@ struct MD_FileIter
 #define MD_DblPushFront(f,l,n) MD_DblPushBack_NPZ(l,f,n,prev,next,MD_CheckNull,MD_SetNull)
 #define MD_DblRemove(f,l,n)    MD_DblRemove_NPZ(f,l,n,next,prev,MD_SetNull)
 
+// NOTE: The node list macros only link nodes. They leave index, child_count,
+// tag_count, tag_bloom, and cached structural hashes as they were. Lookups
+// walk a list that has no count, but a counted list that is edited with these
+// macros gives wrong results from MD_ChildCountFromNode, MD_ChildFromIndex,
+// MD_ChildFromString, and MD_TagFromString, and MD_NodeDeepMatch is wrong for
+// any tree hashed before the edit. Children and tags of a tree should be
+// added with MD_PushChild and MD_PushTag, and removed with MD_RemoveChild and
+// MD_RemoveTag, instead.
 #define MD_NodeDblPushBack(f,l,n)  MD_DblPushBack_NPZ(f,l,n,next,prev,MD_CheckNil,MD_SetNil)
 #define MD_NodeDblPushFront(f,l,n) MD_DblPushBack_NPZ(l,f,n,prev,next,MD_CheckNil,MD_SetNil)
 #define MD_NodeDblRemove(f,l,n)    MD_DblRemove_NPZ(f,l,n,next,prev,MD_SetNil)
@@ -782,10 +1119,17 @@ MD_FUNCTION MD_MapSlot* MD_MapScan(MD_MapSlot *first_slot, MD_MapKey key);
 MD_FUNCTION MD_MapSlot* MD_MapInsert(MD_Map *map, MD_MapKey key, void *val);
 MD_FUNCTION MD_MapSlot* MD_MapOverwrite(MD_Map *map, MD_MapKey key, void *val);
 
+//~ Node Side Tables
+
+MD_FUNCTION MD_NodeTable MD_MakeNodeTable(MD_u64 value_size);
+MD_FUNCTION void *       MD_NodeTableLookup(MD_NodeTable *table, MD_Node *node);
+MD_FUNCTION void *       MD_NodeTableSlotFromNode(MD_NodeTable *table, MD_Node *node);
+
 //~ Parsing
 
 MD_FUNCTION MD_b32         MD_TokenGroupContainsKind(MD_TokenGroups groups, MD_TokenKind kind);
 MD_FUNCTION MD_Token       MD_TokenFromString(MD_String8 string);
+MD_FUNCTION MD_Token       MD_TokenFromStringWithFlags(MD_String8 string, MD_LexFlags flags);
 MD_FUNCTION MD_u64         MD_LexAdvanceFromSkips(MD_String8 string, MD_TokenKind skip_kinds);
 MD_FUNCTION MD_Message *   MD_MakeNodeError(MD_Node *node, MD_MessageKind kind, MD_String8 str);
 MD_FUNCTION MD_Message *   MD_MakeTokenError(MD_String8 parse_contents, MD_Token token, MD_MessageKind kind, MD_String8 str);
@@ -794,13 +1138,28 @@ MD_FUNCTION void           MD_MessageListConcat(MD_MessageList *list, MD_Message
 MD_FUNCTION MD_ParseResult MD_ParseResultZero(void);
 MD_FUNCTION MD_ParseResult MD_ParseOneNode(MD_String8 string, MD_u64 offset);
 MD_FUNCTION MD_ParseResult MD_ParseWholeString(MD_String8 filename, MD_String8 contents);
+MD_FUNCTION MD_ParseResult MD_ParseWholeStringWithOptions(MD_String8 filename, MD_String8 contents, MD_ParseOptions *options);
 
 MD_FUNCTION MD_ParseResult MD_ParseWholeFile(MD_String8 filename);
+MD_FUNCTION MD_ParseResult MD_ParseWholeFileWithOptions(MD_String8 filename, MD_ParseOptions *options);
+
+MD_FUNCTION MD_ParseResult MD_ExpandNode(MD_Node *node);
+MD_FUNCTION MD_MessageKind MD_ParseEventsFromString(MD_String8 contents, MD_ParseOptions *options,
+                                                    MD_ParseEventCallback *callback, void *user_data);
+
+//~ Structural Index
+
+MD_FUNCTION MD_StructuralIndex MD_StructuralIndexFromString(MD_String8 string);
+MD_FUNCTION MD_u64             MD_StructuralIndexEntryFromOffset(MD_StructuralIndex *index, MD_u64 offset);
 
 //~ Location Conversion
 
 MD_FUNCTION MD_CodeLoc MD_CodeLocFromFileOffset(MD_String8 filename, MD_u8 *base, MD_u64 offset);
 MD_FUNCTION MD_CodeLoc MD_CodeLocFromNode(MD_Node *node);
+MD_FUNCTION MD_String8 MD_SourceRangeFromNode(MD_Node *node);
+MD_FUNCTION MD_CodeLoc MD_CodeLocFromRootOffset(MD_Node *root, MD_u64 offset, MD_CodeLocFlags flags);
+MD_FUNCTION void       MD_CodeLocsFromRootOffsets(MD_Node *root, MD_u64 *offsets, MD_u64 count,
+                                                  MD_CodeLocFlags flags, MD_CodeLoc *locs_out);
 
 //~ Tree/List Building
 
@@ -809,9 +1168,25 @@ MD_FUNCTION MD_Node *MD_NilNode(void);
 MD_FUNCTION MD_Node *MD_MakeNode(MD_NodeKind kind, MD_String8 string, MD_String8 raw_string, MD_u64 offset);
 MD_FUNCTION void     MD_PushChild(MD_Node *parent, MD_Node *new_child);
 MD_FUNCTION void     MD_PushTag(MD_Node *node, MD_Node *tag);
+MD_FUNCTION void     MD_RemoveChild(MD_Node *parent, MD_Node *child);
+MD_FUNCTION void     MD_RemoveTag(MD_Node *node, MD_Node *tag);
 
 MD_FUNCTION MD_Node *MD_MakeList(void);
 MD_FUNCTION MD_Node *MD_PushNewReference(MD_Node *list, MD_Node *target);
+MD_FUNCTION void     MD_SortChildren(MD_Node *node, MD_NodeKeyFunction *key, void *user_data);
+MD_FUNCTION void     MD_SortChildrenByString(MD_Node *node, MD_NodeStringKeyFunction *key, void *user_data);
+
+//~ Deep Copy
+
+MD_FUNCTION MD_Node *MD_NodeDeepCopy(MD_Node *node);
+MD_FUNCTION MD_Node *MD_TreeCompact(MD_Node *root);
+
+//~ Persistent Trees
+
+MD_FUNCTION MD_Node *MD_PersistentInsertChild(MD_Node *root, MD_Node *parent, MD_Node *prev_child, MD_Node *new_child);
+MD_FUNCTION MD_Node *MD_PersistentInsertTag(MD_Node *root, MD_Node *node, MD_Node *prev_tag, MD_Node *new_tag);
+MD_FUNCTION MD_Node *MD_PersistentRemove(MD_Node *root, MD_Node *node);
+MD_FUNCTION MD_Node *MD_PersistentReplace(MD_Node *root, MD_Node *node, MD_Node *replacement);
 
 //~ Introspection Helpers
 
@@ -823,7 +1198,9 @@ MD_FUNCTION MD_Node *  MD_NodeFromIndex(MD_Node *first, MD_Node *one_past_last,
 MD_FUNCTION MD_Node *  MD_NodeFromFlags(MD_Node *first, MD_Node *one_past_last, MD_NodeFlags flags);
 MD_FUNCTION int        MD_IndexFromNode(MD_Node *node);
 MD_FUNCTION MD_Node *  MD_RootFromNode(MD_Node *node);
+MD_FUNCTION MD_Node *  MD_FirstChildFromNode(MD_Node *node);
 MD_FUNCTION MD_Node *  MD_ChildFromString(MD_Node *node, MD_String8 child_string, MD_MatchFlags flags);
+MD_FUNCTION void       MD_IndexChildren(MD_Node *node);
 MD_FUNCTION MD_Node *  MD_TagFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags);
 MD_FUNCTION MD_Node *  MD_ChildFromIndex(MD_Node *node, int n);
 MD_FUNCTION MD_Node *  MD_TagFromIndex(MD_Node *node, int n);
@@ -831,6 +1208,7 @@ MD_FUNCTION MD_Node *  MD_TagArgFromIndex(MD_Node *node, MD_String8 tag_string,
 MD_FUNCTION MD_Node *  MD_TagArgFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags tag_str_flags, MD_String8 arg_string, MD_MatchFlags arg_str_flags);
 MD_FUNCTION MD_b32     MD_NodeHasTag(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags);
 MD_FUNCTION MD_i64     MD_ChildCountFromNode(MD_Node *node);
+MD_FUNCTION MD_Node ** MD_ChildArrayFromNode(MD_Node *node);
 MD_FUNCTION MD_i64     MD_TagCountFromNode(MD_Node *node);
 MD_FUNCTION MD_Node *  MD_NodeFromReference(MD_Node *node);
 
@@ -840,6 +1218,53 @@ MD_FUNCTION MD_Node *  MD_NodeFromReference(MD_Node *node);
 !MD_NodeIsNil(it##_r); \
 it##_r = it##_r->next, it = MD_NodeFromReference(it##_r)
 
+//~ Node Arrays
+
+MD_FUNCTION void         MD_NodeArrayPush(MD_NodeArray *array, MD_Node *node);
+MD_FUNCTION MD_NodeArray MD_NodeArrayFromChildren(MD_Node *node);
+MD_FUNCTION MD_NodeArray MD_NodeArrayFromTags(MD_Node *node);
+MD_FUNCTION MD_NodeArray MD_NodeArrayFromReferences(MD_Node *list);
+MD_FUNCTION MD_NodeArray MD_NodeArrayCopy(MD_NodeArray array);
+MD_FUNCTION MD_NodeArray MD_NodeArraySort(MD_NodeArray array, MD_NodeKeyFunction *key, void *user_data);
+MD_FUNCTION MD_NodeArray MD_NodeArraySortByString(MD_NodeArray array, MD_NodeStringKeyFunction *key, void *user_data);
+MD_FUNCTION MD_NodeArray MD_NodeArrayMerge(MD_NodeArray a, MD_NodeArray b, MD_NodeKeyFunction *key, void *user_data);
+MD_FUNCTION MD_NodeArray MD_NodeArrayFilter(MD_NodeArray array, MD_NodeFilterFunction *filter, void *user_data);
+MD_FUNCTION MD_NodeArray MD_NodeArrayUnique(MD_NodeArray array);
+MD_FUNCTION MD_NodeArray MD_NodeArrayUnion(MD_NodeArray a, MD_NodeArray b);
+MD_FUNCTION MD_NodeArray MD_NodeArrayIntersect(MD_NodeArray a, MD_NodeArray b);
+MD_FUNCTION MD_NodeArray MD_NodeArrayDifference(MD_NodeArray a, MD_NodeArray b);
+
+#define MD_EachNodeInArray(it, array) MD_Node **it##_p = (array).v, *it = 0; \
+it##_p < (array).v + (array).count && ((it = *it##_p), 1); \
+it##_p += 1
+
+//~ Tree-Wide Indexes
+
+MD_FUNCTION MD_Index     MD_MakeIndex(void);
+MD_FUNCTION MD_Index     MD_IndexFromTree(MD_Node *root);
+MD_FUNCTION void         MD_IndexAddSubtree(MD_Index *index, MD_Node *node);
+MD_FUNCTION void         MD_IndexRemoveSubtree(MD_Index *index, MD_Node *node);
+MD_FUNCTION MD_NodeArray MD_NodesFromTag(MD_Index *index, MD_String8 tag_string);
+MD_FUNCTION MD_NodeArray MD_NodesFromString(MD_Index *index, MD_String8 string);
+
+//~ Selectors
+
+MD_FUNCTION MD_Selector  MD_SelectorFromString(MD_String8 string);
+MD_FUNCTION MD_NodeArray MD_NodesFromSelector(MD_Node *node, MD_Selector *selector, MD_Index *index);
+
+//~ Frozen Trees
+
+MD_FUNCTION MD_FrozenTree MD_FreezeTree(MD_Node *root);
+MD_FUNCTION MD_String8    MD_StringFromFrozenNode(MD_FrozenTree *tree, MD_u32 i);
+MD_FUNCTION MD_u64        MD_FrozenIndicesFromKind(MD_FrozenTree *tree, MD_u32 first, MD_u32 one_past_last,
+                                                   MD_NodeKind kind, MD_u32 *indices_out);
+MD_FUNCTION MD_u64        MD_FrozenIndicesFromFlags(MD_FrozenTree *tree, MD_u32 first, MD_u32 one_past_last,
+                                                    MD_NodeFlags flags, MD_u32 *indices_out);
+
+// NOTE: Iterates over the children, or tags, of frozen node i.
+#define MD_EachFrozenChild(it, tree, i) MD_u32 it = (tree)->first_children[i]; it != 0; it = (tree)->next_siblings[it]
+#define MD_EachFrozenTag(it, tree, i) MD_u32 it = ((tree)->tag_counts[i] ? (i) + 1 : 0); it != 0; it = (tree)->next_siblings[it]
+
 //~ Error/Warning Helpers
 
 MD_FUNCTION void MD_PrintMessage(FILE *out, MD_CodeLoc loc, MD_MessageKind kind, MD_String8 str);
@@ -849,8 +1274,10 @@ MD_FUNCTION void MD_PrintNodeMessageFmt(FILE *out, MD_Node *node, MD_MessageKind
 
 //~ Tree Comparison/Verification
 
+MD_FUNCTION MD_u64 MD_NodeStructuralHash(MD_Node *node, MD_MatchFlags flags);
 MD_FUNCTION MD_b32 MD_NodeMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags);
 MD_FUNCTION MD_b32 MD_NodeDeepMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags);
+MD_FUNCTION MD_TreeEditList MD_TreeDiff(MD_Node *old_root, MD_Node *new_root, MD_MatchFlags flags);
 
 //~ Generation
 
@@ -867,8 +1294,24 @@ MD_FUNCTION MD_i64 MD_CmdLineI64FromString(MD_CmdLine cmdln, MD_String8 name);
 //~ File System
 
 MD_FUNCTION MD_String8  MD_LoadEntireFile(MD_String8 filename);
+MD_FUNCTION MD_String8  MD_MapEntireFile(MD_String8 filename);
+MD_FUNCTION MD_b32      MD_WriteEntireFile(MD_String8 filename, MD_String8 data);
 MD_FUNCTION MD_b32      MD_FileIterIncrement(MD_FileIter *it, MD_String8 path, MD_FileInfo *out_info);
 
+//~ Binary Trees
+
+MD_FUNCTION MD_String8     MD_BinaryFromParseResult(MD_ParseResult parse);
+MD_FUNCTION MD_ParseResult MD_ParseResultFromBinary(MD_String8 data);
+MD_FUNCTION MD_ParseResult MD_LoadBinaryFile(MD_String8 filename);
+
+//~ Hot Reload
+
+MD_FUNCTION MD_HotReload *MD_MakeHotReload(MD_String8 filename, MD_ParseOptions *options, MD_u64 reader_count);
+MD_FUNCTION MD_b32        MD_HotReloadPoll(MD_HotReload *reload);
+MD_FUNCTION MD_b32        MD_HotReloadPublishString(MD_HotReload *reload, MD_String8 contents);
+MD_FUNCTION MD_Node *     MD_HotReloadBeginRead(MD_HotReload *reload, MD_u64 reader_index);
+MD_FUNCTION void          MD_HotReloadEndRead(MD_HotReload *reload, MD_u64 reader_index);
+
 #endif // MD_H
 
 /*
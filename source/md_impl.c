@@ -8,6 +8,13 @@
 #define STB_SPRINTF_DECORATE(name) md_stbsp_##name
 #include "md_stb_sprintf.h"
 
+#if MD_ARCH_X64
+# include <emmintrin.h>
+#endif
+#if MD_COMPILER_CL
+# include <intrin.h>
+#endif
+
 //~ Nil Node Definition
 
 static MD_Node _md_nil_node =
@@ -19,6 +26,13 @@ static MD_Node _md_nil_node =
     &_md_nil_node,         // last_child
     &_md_nil_node,         // first_tag
     &_md_nil_node,         // last_tag
+    0,                     // index
+    0,                     // child_count
+    0,                     // tag_count
+    0,                     // tag_bloom
+    0,                     // id
+    0,                     // structural_hash_key
+    0,                     // structural_hash
     MD_NodeKind_Nil,       // kind
     0,                     // flags
     MD_ZERO_STRUCT,        // string
@@ -27,7 +41,10 @@ static MD_Node _md_nil_node =
     MD_ZERO_STRUCT,        // prev_comment
     MD_ZERO_STRUCT,        // next_comment
     0,                     // at
+    0,                     // end_offset
     &_md_nil_node,         // ref_target
+    0,                     // unexpanded
+    0,                     // accel
 };
 
 //~ Memory Operations
@@ -56,6 +73,103 @@ MD_AllocZero(MD_u64 size)
 #endif
 }
 
+//~ SIMD Helpers
+
+#if MD_ARCH_X64
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_CountTrailingZeros64(MD_u64 v)
+{
+#if MD_COMPILER_CL
+    unsigned long result = 0;
+    _BitScanForward64(&result, v);
+    return result;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_PopCount32(MD_u32 v)
+{
+#if MD_COMPILER_CL
+    return __popcnt(v);
+#else
+    return __builtin_popcount(v);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL __m128i
+_MD_BytesInRange16(__m128i bytes, MD_u8 min, MD_u8 max)
+{
+    __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8((char)min));
+    __m128i excess = _mm_subs_epu8(shifted, _mm_set1_epi8((char)(max - min)));
+    return _mm_cmpeq_epi8(excess, _mm_setzero_si128());
+}
+#endif
+
+//~ Atomics
+
+// NOTE: All sequentially consistent; used where the library hands data
+// between threads.
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_AtomicLoadU64(volatile MD_u64 *x)
+{
+#if MD_COMPILER_CL
+    return (MD_u64)_InterlockedCompareExchange64((volatile __int64 *)x, 0, 0);
+#else
+    return __atomic_load_n(x, __ATOMIC_SEQ_CST);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_AtomicStoreU64(volatile MD_u64 *x, MD_u64 value)
+{
+#if MD_COMPILER_CL
+    for(__int64 old = *(volatile __int64 *)x;;)
+    {
+        __int64 seen = _InterlockedCompareExchange64((volatile __int64 *)x, (__int64)value, old);
+        if(seen == old)
+        {
+            break;
+        }
+        old = seen;
+    }
+#else
+    __atomic_store_n(x, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u32
+_MD_AtomicIncrementU32(volatile MD_u32 *x)
+{
+#if MD_COMPILER_CL
+    return (MD_u32)_InterlockedIncrement((volatile long *)x);
+#else
+    return __atomic_add_fetch(x, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL void *
+_MD_AtomicLoadPtr(void *volatile *x)
+{
+#if MD_COMPILER_CL
+    return _InterlockedCompareExchangePointer(x, 0, 0);
+#else
+    return __atomic_load_n(x, __ATOMIC_SEQ_CST);
+#endif
+}
+
+MD_PRIVATE_FUNCTION_IMPL void *
+_MD_AtomicExchangePtr(void *volatile *x, void *value)
+{
+#if MD_COMPILER_CL
+    return _InterlockedExchangePointer(x, value);
+#else
+    return __atomic_exchange_n(x, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
 //~ Characters
 
 MD_FUNCTION_IMPL MD_b32
@@ -898,8 +1012,8 @@ MD_FUNCTION_IMPL MD_String8
 MD_CStyleHexStringFromU64(MD_u64 x, MD_b32 caps)
 {
     static char md_int_value_to_char[] = "0123456789abcdef";
-    MD_u8 buffer[10];
-    MD_u8 *opl = buffer + 10;
+    MD_u8 buffer[18];
+    MD_u8 *opl = buffer + 18;
     MD_u8 *ptr = opl;
     if (x == 0){
         ptr -= 1;
@@ -926,9 +1040,9 @@ MD_CStyleHexStringFromU64(MD_u64 x, MD_b32 caps)
     *ptr = '0';
     
     MD_String8 result = MD_ZERO_STRUCT;
-    result.size = (MD_u64)(ptr - buffer);
+    result.size = (MD_u64)(opl - ptr);
     result.str = MD_PushArray(MD_u8, result.size);
-    MD_MemoryCopy(result.str, buffer, result.size);
+    MD_MemoryCopy(result.str, ptr, result.size);
     return(result);
 }
 
@@ -1129,1500 +1243,5990 @@ MD_MapOverwrite(MD_Map *map, MD_MapKey key, void *val){
     return(result);
 }
 
-//~ Parsing
+//~ Node Side Tables
 
-MD_FUNCTION MD_b32
-MD_TokenGroupContainsKind(MD_TokenGroups groups, MD_TokenKind kind)
+MD_GLOBAL volatile MD_u32 _md_last_node_id = 0;
+
+// NOTE: IDs are handed out in order, so nodes made together land on the
+// same pages of an MD_NodeTable. Trees may be parsed on another thread while
+// readers use the last one (see MD_HotReload), so this is atomic.
+MD_PRIVATE_FUNCTION_IMPL MD_u32
+_MD_MakeNodeId(void)
 {
-    return (groups & kind) != 0;
+    return _MD_AtomicIncrementU32(&_md_last_node_id);
 }
 
-MD_FUNCTION_IMPL MD_Token
-MD_TokenFromString(MD_String8 string)
+MD_FUNCTION_IMPL MD_NodeTable
+MD_MakeNodeTable(MD_u64 value_size)
 {
-    MD_Token token = MD_ZERO_STRUCT;
+    MD_NodeTable table = MD_ZERO_STRUCT;
+    table.value_size = value_size;
+    return table;
+}
+
+MD_FUNCTION_IMPL void *
+MD_NodeTableLookup(MD_NodeTable *table, MD_Node *node)
+{
+    void *result = 0;
+    MD_u64 page_index = node->id / MD_NODE_TABLE_PAGE_SIZE;
+    if(node->id != 0 && page_index < table->page_count && table->pages[page_index] != 0)
+    {
+        result = table->pages[page_index] + (node->id % MD_NODE_TABLE_PAGE_SIZE)*table->value_size;
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL void *
+MD_NodeTableSlotFromNode(MD_NodeTable *table, MD_Node *node)
+{
+    void *result = 0;
+    if(node->id == 0)
+    {
+        // NOTE: Nodes without IDs share nothing, so get a fresh, zeroed value.
+        result = MD_PushArrayZero(MD_u8, table->value_size);
+    }
+    else
+    {
+        MD_u64 page_index = node->id / MD_NODE_TABLE_PAGE_SIZE;
+        if(page_index >= table->page_count)
+        {
+            MD_u64 new_page_count = table->page_count ? table->page_count*2 : 16;
+            for(; new_page_count <= page_index; new_page_count *= 2);
+            MD_u8 **new_pages = MD_PushArrayZero(MD_u8 *, new_page_count);
+            MD_MemoryCopy(new_pages, table->pages, sizeof(MD_u8 *)*table->page_count);
+            table->pages = new_pages;
+            table->page_count = new_page_count;
+        }
+        if(table->pages[page_index] == 0)
+        {
+            table->pages[page_index] = MD_PushArrayZero(MD_u8, table->value_size*MD_NODE_TABLE_PAGE_SIZE);
+        }
+        result = table->pages[page_index] + (node->id % MD_NODE_TABLE_PAGE_SIZE)*table->value_size;
+    }
+    return result;
+}
+
+//~ Node Acceleration
+
+struct MD_NodeAccel
+{
+    // NOTE: For file roots; the offset at which each line of raw_string begins.
+    MD_u64 *line_offsets;
+    MD_u64 line_count;
     
-    MD_u8 *one_past_last = string.str + string.size;
-    MD_u8 *first = string.str;
+    // NOTE: Children in order; see MD_ChildArrayFromNode.
+    MD_Node **child_array;
+    MD_u64 child_array_count;
+    MD_u64 child_array_cap;
     
-    if(first < one_past_last)
+    // NOTE: Open-addressed table of the first child with each string;
+    // see MD_IndexChildren.
+    MD_Node **name_slots;
+    MD_u64 *name_hashes;
+    MD_u64 name_slot_cap;
+    MD_u64 name_count;
+    MD_u64 name_indexed_child_count;
+    MD_Node *name_last_indexed_child;
+    
+    // NOTE: For roots; set once the tree is shared between threads, after
+    // which lookups that would cache into its nodes compute without caching.
+    MD_b32 read_only;
+};
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64 _MD_HashMix(MD_u64 h, MD_u64 v);
+
+// NOTE: Two bits per string, taken from disjoint parts of its hash. The
+// hash of a short string has few high bits set, so it is mixed first.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_TagBloomFromString(MD_String8 string)
+{
+    MD_u64 hash = _MD_HashMix(0, MD_HashStr(string));
+    return (1ull << (hash & 63)) | (1ull << ((hash >> 32) & 63));
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeAccel *
+_MD_AccelFromNode(MD_Node *node)
+{
+    // NOTE: The nil node is shared, so it gets a fresh, empty set each time.
+    MD_NodeAccel *accel = node->accel;
+    if(accel == 0)
     {
-        MD_u8 *at = first;
-        MD_u32 skip_n = 0;
-        MD_u32 chop_n = 0;
-        
-#define MD_TokenizerScan(cond) for (; at < one_past_last && (cond); at += 1)
-        
-        switch (*at)
+        accel = MD_PushArray(MD_NodeAccel, 1);
+        if(!MD_NodeIsNil(node))
         {
-            // NOTE(allen): Whitespace parsing
-            case '\n':
-            {
-                token.kind = MD_TokenKind_Newline;
-                at += 1;
-            }break;
-            
-            case ' ': case '\r': case '\t': case '\f': case '\v':
-            {
-                token.kind = MD_TokenKind_Whitespace;
-                at += 1;
-                MD_TokenizerScan(*at == ' ' || *at == '\r' || *at == '\t' || *at == '\f' || *at == '\v');
-            }break;
-            
-            // NOTE(allen): Comment parsing
-            case '/':
+            node->accel = accel;
+        }
+    }
+    return accel;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_NodeIsReadOnly(MD_Node *node)
+{
+    MD_Node *root = MD_RootFromNode(node);
+    return (root->accel != 0 && root->accel->read_only);
+}
+
+//~ Node Arrays
+
+MD_FUNCTION_IMPL void
+MD_NodeArrayPush(MD_NodeArray *array, MD_Node *node)
+{
+    if(array->count == array->cap)
+    {
+        MD_u64 new_cap = array->cap ? array->cap*2 : 8;
+        MD_Node **new_v = MD_PushArray(MD_Node *, new_cap);
+        MD_MemoryCopy(new_v, array->v, sizeof(MD_Node *)*array->count);
+        array->v = new_v;
+        array->cap = new_cap;
+    }
+    array->v[array->count] = node;
+    array->count += 1;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeArray
+_MD_MakeNodeArray(MD_u64 cap)
+{
+    MD_NodeArray result = MD_ZERO_STRUCT;
+    result.v = MD_PushArray(MD_Node *, cap ? cap : 1);
+    result.cap = cap;
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayFromChildren(MD_Node *node)
+{
+    MD_Node *first = MD_FirstChildFromNode(node);
+    MD_NodeArray result = _MD_MakeNodeArray(node->child_count);
+    for(MD_EachNode(child, first))
+    {
+        MD_NodeArrayPush(&result, child);
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayFromTags(MD_Node *node)
+{
+    MD_NodeArray result = _MD_MakeNodeArray(node->tag_count);
+    for(MD_EachNode(tag, node->first_tag))
+    {
+        MD_NodeArrayPush(&result, tag);
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayFromReferences(MD_Node *list)
+{
+    MD_NodeArray result = _MD_MakeNodeArray(list->child_count);
+    for(MD_EachNodeRef(target, list->first_child))
+    {
+        MD_NodeArrayPush(&result, target);
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayCopy(MD_NodeArray array)
+{
+    MD_NodeArray result = _MD_MakeNodeArray(array.count);
+    MD_MemoryCopy(result.v, array.v, sizeof(MD_Node *)*array.count);
+    result.count = array.count;
+    return result;
+}
+
+//- sorting
+
+typedef struct _MD_KeyedNode _MD_KeyedNode;
+struct _MD_KeyedNode
+{
+    MD_u64 key;
+    MD_Node *node;
+};
+
+typedef struct _MD_StringKeyedNode _MD_StringKeyedNode;
+struct _MD_StringKeyedNode
+{
+    MD_String8 key;
+    MD_Node *node;
+};
+
+// NOTE: LSD radix sort, a byte at a time, which is stable. The counts for
+// every byte are taken in one pass, and bytes that are the same for every key
+// are skipped. Returns the buffer that holds the result.
+MD_PRIVATE_FUNCTION_IMPL _MD_KeyedNode *
+_MD_RadixSortKeyed(_MD_KeyedNode *items, _MD_KeyedNode *temp, MD_u64 count)
+{
+    MD_u64 *counts = MD_PushArrayZero(MD_u64, 8*256);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        MD_u64 key = items[i].key;
+        for(MD_u64 b = 0; b < 8; b += 1)
+        {
+            counts[b*256 + ((key >> (b*8)) & 0xff)] += 1;
+        }
+    }
+    _MD_KeyedNode *src = items;
+    _MD_KeyedNode *dst = temp;
+    for(MD_u64 b = 0; b < 8 && count != 0; b += 1)
+    {
+        MD_u64 *byte_counts = counts + b*256;
+        if(byte_counts[(src[0].key >> (b*8)) & 0xff] == count)
+        {
+            continue;
+        }
+        MD_u64 sum = 0;
+        for(MD_u64 v = 0; v < 256; v += 1)
+        {
+            MD_u64 c = byte_counts[v];
+            byte_counts[v] = sum;
+            sum += c;
+        }
+        for(MD_u64 i = 0; i < count; i += 1)
+        {
+            dst[byte_counts[(src[i].key >> (b*8)) & 0xff]++] = src[i];
+        }
+        _MD_KeyedNode *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return src;
+}
+
+MD_PRIVATE_FUNCTION_IMPL int
+_MD_CompareStringKeys(MD_String8 a, MD_String8 b, MD_u64 depth)
+{
+    MD_u64 size = a.size < b.size ? a.size : b.size;
+    int result = size > depth ? memcmp(a.str + depth, b.str + depth, size - depth) : 0;
+    if(result == 0)
+    {
+        result = (a.size > b.size) - (a.size < b.size);
+    }
+    return result;
+}
+
+// NOTE: MSD radix sort on the bytes of each key, which is stable. Keys
+// that end at the current depth sort before every byte; small ranges are left
+// to an insertion sort.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_RadixSortStrings(_MD_StringKeyedNode *items, _MD_StringKeyedNode *temp, MD_u64 count, MD_u64 depth)
+{
+    for(;;)
+    {
+        if(count <= 32)
+        {
+            for(MD_u64 i = 1; i < count; i += 1)
             {
-                if (at + 1 < one_past_last)
+                _MD_StringKeyedNode item = items[i];
+                MD_u64 j = i;
+                for(; j > 0 && _MD_CompareStringKeys(items[j-1].key, item.key, depth) > 0; j -= 1)
                 {
-                    if (at[1] == '/')
-                    {
-                        // trim off the first '//'
-                        skip_n = 2;
-                        at += 2;
-                        token.kind = MD_TokenKind_Comment;
-                        MD_TokenizerScan(*at != '\n' && *at != '\r');
-                    }
-                    else if (at[1] == '*')
-                    {
-                        // trim off the first '/*'
-                        skip_n = 2;
-                        at += 2;
-                        token.kind = MD_TokenKind_BrokenComment;
-                        int counter = 1;
-                        for (;at < one_past_last && counter > 0; at += 1)
-                        {
-                            if (at + 1 < one_past_last)
-                            {
-                                if (at[0] == '*' && at[1] == '/')
-                                {
-                                    at += 1;
-                                    counter -= 1;
-                                }
-                                else if (at[0] == '/' && at[1] == '*')
-                                {
-                                    at += 1;
-                                    counter += 1;
-                                }
-                            }
-                        }
-                        if(counter == 0)
-                        {
-                            token.kind = MD_TokenKind_Comment;
-                            chop_n = 2;
-                        }
-                    }
+                    items[j] = items[j-1];
                 }
-                if (token.kind == 0) goto symbol_lex;
-            }break;
-            
-            // NOTE(allen): Strings
-            case '"':
-            case '\'':
-            case '`':
+                items[j] = item;
+            }
+            break;
+        }
+        
+        //- count; bucket 0 holds keys that have ended
+        MD_u64 counts[257] = {0};
+        for(MD_u64 i = 0; i < count; i += 1)
+        {
+            MD_String8 key = items[i].key;
+            counts[key.size > depth ? key.str[depth] + 1 : 0] += 1;
+        }
+        
+        //- when every key falls in one bucket, look at the next byte
+        MD_String8 first_key = items[0].key;
+        MD_u64 first_bucket = first_key.size > depth ? first_key.str[depth] + 1 : 0;
+        if(counts[first_bucket] == count)
+        {
+            if(first_bucket == 0)
             {
-                token.kind = MD_TokenKind_BrokenStringLiteral;
-                
-                // determine delimiter setup
-                MD_u8 d = *at;
-                MD_b32 is_triplet = (at + 2 < one_past_last && at[1] == d && at[2] == d);
-                
-                // lex triple-delimiter string
-                if (is_triplet)
-                {
-                    skip_n = 3;
-                    at += 3;
-                    MD_u32 consecutive_d = 0;
-                    for (;;)
-                    {
-                        // fail condition
-                        if (at >= one_past_last){
-                            break;
-                        }
-                        
-                        if(at[0] == d)
-                        {
-                            consecutive_d += 1;
-                            at += 1;
-                            // close condition
-                            if (consecutive_d == 3){
-                                chop_n = 3;
-                                token.kind = MD_TokenKind_StringLiteral;
-                                break;
-                            }
-                        }
-                        else
-                        {
-                            consecutive_d = 0;
-                            
-                            // escaping rule
-                            if(at[0] == '\\')
-                            {
-                                at += 1;
-                                if(at < one_past_last && (at[0] == d || at[0] == '\\'))
-                                {
-                                    at += 1;
-                                }
-                            }
-                            else{
-                                at += 1;
-                            }
-                        }
-                    }
-                }
-                
-                // lex single-delimiter string
-                if (!is_triplet)
-                {
-                    skip_n = 1;
-                    at += 1;
-                    for (;at < one_past_last;)
-                    {
-                        // close condition
-                        if (*at == d){
-                            at += 1;
-                            chop_n = 1;
-                            token.kind = MD_TokenKind_StringLiteral;
-                            break;
-                        }
-                        
-                        // fail condition
-                        if (*at == '\n'){
-                            break;
-                        }
-                        
-                        // escaping rule
-                        if (at[0] == '\\'){
-                            at += 1;
-                            if (at < one_past_last && (at[0] == d || at[0] == '\\')){
-                                at += 1;
-                            }
-                        }
-                        else{
-                            at += 1;
-                        }
-                    }
-                }
-                
-                //- rjf: set relevant node flags on token
-                token.node_flags |= MD_NodeFlag_StringLiteral;
-                switch(d)
-                {
-                    case '\'': token.node_flags |= MD_NodeFlag_StringSingleQuote; break;
-                    case '"':  token.node_flags |= MD_NodeFlag_StringDoubleQuote; break;
-                    case '`':  token.node_flags |= MD_NodeFlag_StringTick; break;
-                    default: break;
-                }
-                if(is_triplet)
-                {
-                    token.node_flags |= MD_NodeFlag_StringTriplet;
-                }
-                
-            }break;
-            
-            // NOTE(allen): Identifiers, Numbers, Operators
-            default:
-            {
-                if (MD_CharIsAlpha(*at) || *at == '_')
-                {
-                    token.node_flags |= MD_NodeFlag_Identifier;
-                    token.kind = MD_TokenKind_Identifier;
-                    at += 1;
-                    MD_TokenizerScan(MD_CharIsAlpha(*at) || MD_CharIsDigit(*at) || *at == '_');
-                }
-                
-                else if (MD_CharIsDigit(*at))
-                {
-                    token.node_flags |= MD_NodeFlag_Numeric;
-                    token.kind = MD_TokenKind_NumericLiteral;
-                    at += 1;
-                    
-                    for (; at < one_past_last;){
-                        MD_b32 good = 0;
-                        if (*at == 'e' || *at == 'E'){
-                            good = 1;
-                            at += 1;
-                            if (at < one_past_last &&
-                                (*at == '+' || *at == '-')){
-                                at += 1;
-                            }
-                        }
-                        else if (MD_CharIsAlpha(*at) || MD_CharIsDigit(*at) || *at == '.'){
-                            good = 1;
-                            at += 1;
-                        }
-                        if (!good){
-                            break;
-                        }
-                    }
-                }
-                
-                else if (MD_CharIsUnreservedSymbol(*at))
-                {
-                    symbol_lex:
-                    token.kind = MD_TokenKind_Symbol;
-                    at += 1;
-                }
-                
-                else if (MD_CharIsReservedSymbol(*at))
-                {
-                    token.kind = MD_TokenKind_Reserved;
-                    at += 1;
-                }
-                
-                else
-                {
-                    token.kind = MD_TokenKind_BadCharacter;
-                    at += 1;
-                }
-            }break;
+                break;
+            }
+            depth += 1;
+            continue;
         }
         
-        token.raw_string = MD_S8Range(first, at);
-        token.string = MD_S8Substring(token.raw_string, skip_n, token.raw_string.size - chop_n);
-        
-#undef MD_TokenizerScan
-        
+        //- scatter, then sort each bucket on the next byte
+        MD_u64 starts[257];
+        MD_u64 sum = 0;
+        for(MD_u64 v = 0; v < 257; v += 1)
+        {
+            starts[v] = sum;
+            sum += counts[v];
+        }
+        for(MD_u64 i = 0; i < count; i += 1)
+        {
+            MD_String8 key = items[i].key;
+            temp[starts[key.size > depth ? key.str[depth] + 1 : 0]++] = items[i];
+        }
+        MD_MemoryCopy(items, temp, sizeof(*items)*count);
+        MD_u64 start = counts[0];
+        for(MD_u64 v = 1; v < 257; v += 1)
+        {
+            if(counts[v] > 1)
+            {
+                _MD_RadixSortStrings(items + start, temp, counts[v], depth + 1);
+            }
+            start += counts[v];
+        }
+        break;
+    }
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArraySort(MD_NodeArray array, MD_NodeKeyFunction *key, void *user_data)
+{
+    MD_u64 count = array.count;
+    _MD_KeyedNode *items = MD_PushArray(_MD_KeyedNode, count + 1);
+    _MD_KeyedNode *temp = MD_PushArray(_MD_KeyedNode, count + 1);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        items[i].key = key(array.v[i], user_data);
+        items[i].node = array.v[i];
+    }
+    _MD_KeyedNode *sorted = _MD_RadixSortKeyed(items, temp, count);
+    MD_NodeArray result = _MD_MakeNodeArray(count);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        result.v[i] = sorted[i].node;
+    }
+    result.count = count;
+    return result;
+}
+
+// NOTE: Keys are first sorted by their first 8 bytes, held inline as an
+// integer so that the passes do not touch the strings; only runs that share
+// those bytes are then sorted on the rest of their strings.
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArraySortByString(MD_NodeArray array, MD_NodeStringKeyFunction *key, void *user_data)
+{
+    MD_u64 count = array.count;
+    MD_String8 *keys = MD_PushArray(MD_String8, count + 1);
+    _MD_KeyedNode *prefixed = MD_PushArray(_MD_KeyedNode, count + 1);
+    _MD_KeyedNode *prefixed_temp = MD_PushArray(_MD_KeyedNode, count + 1);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        MD_String8 string = key(array.v[i], user_data);
+        MD_u64 prefix = 0;
+        for(MD_u64 b = 0; b < 8; b += 1)
+        {
+            prefix = (prefix << 8) | (b < string.size ? string.str[b] : 0);
+        }
+        keys[i] = string;
+        prefixed[i].key = prefix;
+        prefixed[i].node = (MD_Node *)(keys + i);
     }
+    _MD_KeyedNode *sorted = _MD_RadixSortKeyed(prefixed, prefixed_temp, count);
     
-    return token;
+    //- sort runs with equal prefixes on the rest of their keys
+    _MD_StringKeyedNode *items = MD_PushArray(_MD_StringKeyedNode, count + 1);
+    _MD_StringKeyedNode *temp = MD_PushArray(_MD_StringKeyedNode, count + 1);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        MD_u64 key_index = (MD_String8 *)sorted[i].node - keys;
+        items[i].key = keys[key_index];
+        items[i].node = array.v[key_index];
+    }
+    for(MD_u64 first = 0, opl = 1; first < count; first = opl, opl = first + 1)
+    {
+        MD_u64 min_size = items[first].key.size;
+        for(; opl < count && sorted[opl].key == sorted[first].key; opl += 1)
+        {
+            min_size = items[opl].key.size < min_size ? items[opl].key.size : min_size;
+        }
+        if(opl - first > 1)
+        {
+            _MD_RadixSortStrings(items + first, temp, opl - first, min_size < 8 ? min_size : 8);
+        }
+    }
+    
+    MD_NodeArray result = _MD_MakeNodeArray(count);
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        result.v[i] = items[i].node;
+    }
+    result.count = count;
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_u64
-MD_LexAdvanceFromSkips(MD_String8 string, MD_TokenKind skip_kinds)
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayMerge(MD_NodeArray a, MD_NodeArray b, MD_NodeKeyFunction *key, void *user_data)
 {
-    MD_u64 result = string.size;
-    MD_u64 p = 0;
-    for (;;)
+    MD_NodeArray result = _MD_MakeNodeArray(a.count + b.count);
+    MD_u64 ai = 0, bi = 0;
+    MD_u64 a_key = a.count ? key(a.v[0], user_data) : 0;
+    MD_u64 b_key = b.count ? key(b.v[0], user_data) : 0;
+    for(; ai < a.count && bi < b.count;)
     {
-        MD_Token token = MD_TokenFromString(MD_S8Skip(string, p));
-        if ((skip_kinds & token.kind) == 0)
+        if(b_key < a_key)
         {
-            result = p;
-            break;
+            MD_NodeArrayPush(&result, b.v[bi]);
+            bi += 1;
+            b_key = bi < b.count ? key(b.v[bi], user_data) : 0;
+        }
+        else
+        {
+            MD_NodeArrayPush(&result, a.v[ai]);
+            ai += 1;
+            a_key = ai < a.count ? key(a.v[ai], user_data) : 0;
         }
-        p += token.raw_string.size;
     }
-    return(result);
+    for(; ai < a.count; ai += 1) { MD_NodeArrayPush(&result, a.v[ai]); }
+    for(; bi < b.count; bi += 1) { MD_NodeArrayPush(&result, b.v[bi]); }
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_Message *
-MD_MakeNodeError(MD_Node *node, MD_MessageKind kind, MD_String8 str)
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayFilter(MD_NodeArray array, MD_NodeFilterFunction *filter, void *user_data)
 {
-    MD_Message *error = MD_PushArrayZero(MD_Message, 1);
-    error->node = node;
-    error->kind = kind;
-    error->string = str;
-    return error;
+    MD_NodeArray result = _MD_MakeNodeArray(array.count);
+    for(MD_u64 i = 0; i < array.count; i += 1)
+    {
+        if(filter(array.v[i], user_data))
+        {
+            MD_NodeArrayPush(&result, array.v[i]);
+        }
+    }
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_Message *
-MD_MakeTokenError(MD_String8 parse_contents, MD_Token token, MD_MessageKind kind, MD_String8 str)
+//- set operations
+
+// NOTE: An open-addressed set of node pointers, which only grows.
+typedef struct _MD_NodeSet _MD_NodeSet;
+struct _MD_NodeSet
 {
-    MD_Node *err_node = MD_MakeNode(MD_NodeKind_ErrorMarker, MD_S8Lit(""), parse_contents,
-                                    token.raw_string.str - parse_contents.str);
-    return MD_MakeNodeError(err_node, kind, str);
+    MD_Node **slots;
+    MD_u64 mask;
+};
+
+MD_PRIVATE_FUNCTION_IMPL _MD_NodeSet
+_MD_MakeNodeSet(MD_u64 count)
+{
+    _MD_NodeSet set = MD_ZERO_STRUCT;
+    MD_u64 cap = 16;
+    for(; cap < 2*count; cap *= 2);
+    set.slots = MD_PushArrayZero(MD_Node *, cap);
+    set.mask = cap - 1;
+    return set;
 }
 
-MD_FUNCTION_IMPL void
-MD_MessageListPush(MD_MessageList *list, MD_Message *message)
+// NOTE: Returns whether the node was newly added.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_NodeSetInsert(_MD_NodeSet *set, MD_Node *node)
 {
-    MD_QueuePush(list->first, list->last, message);
-    if(message->kind > list->max_message_kind)
+    MD_b32 result = 0;
+    for(MD_u64 i = MD_HashPtr(node) & set->mask;; i = (i + 1) & set->mask)
     {
-        list->max_message_kind = message->kind;
+        if(set->slots[i] == node)
+        {
+            break;
+        }
+        if(set->slots[i] == 0)
+        {
+            set->slots[i] = node;
+            result = 1;
+            break;
+        }
     }
-    list->node_count += 1;
+    return result;
 }
 
-MD_FUNCTION_IMPL void
-MD_MessageListConcat(MD_MessageList *list, MD_MessageList *to_push)
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_NodeSetContains(_MD_NodeSet *set, MD_Node *node)
 {
-    if(list->last)
+    MD_b32 result = 0;
+    for(MD_u64 i = MD_HashPtr(node) & set->mask; set->slots[i] != 0; i = (i + 1) & set->mask)
     {
-        if(to_push->node_count != 0)
+        if(set->slots[i] == node)
         {
-            list->last->next = to_push->first;
-            list->last = to_push->last;
-            list->node_count += to_push->node_count;
-            if(to_push->max_message_kind > list->max_message_kind)
-            {
-                list->max_message_kind = to_push->max_message_kind;
-            }
+            result = 1;
+            break;
         }
     }
-    else
-    {
-        *list = *to_push;
-    }
-    MD_MemoryZero(to_push, sizeof(*to_push));
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_ParseResult
-MD_ParseResultZero(void)
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayUnique(MD_NodeArray array)
 {
-    MD_ParseResult result = MD_ZERO_STRUCT;
-    result.node = result.last_node = MD_NilNode();
+    MD_NodeArray result = _MD_MakeNodeArray(array.count);
+    _MD_NodeSet seen = _MD_MakeNodeSet(array.count);
+    for(MD_u64 i = 0; i < array.count; i += 1)
+    {
+        if(_MD_NodeSetInsert(&seen, array.v[i]))
+        {
+            MD_NodeArrayPush(&result, array.v[i]);
+        }
+    }
     return result;
 }
 
-MD_FUNCTION_IMPL MD_ParseResult
-MD_ParseNodeSet(MD_String8 string, MD_u64 offset, MD_Node *parent, MD_ParseSetRule rule)
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayUnion(MD_NodeArray a, MD_NodeArray b)
 {
-    MD_ParseResult result = MD_ParseResultZero();
-    MD_u64 off = offset;
-    
-    //- rjf: fill data from set opener
-    MD_Token initial_token = MD_TokenFromString(MD_S8Skip(string, offset));
-    MD_u8 set_opener = 0;
-    MD_NodeFlags set_opener_flags = 0;
-    MD_b32 close_with_brace = 0;
-    MD_b32 close_with_paren = 0;
-    MD_b32 close_with_separator = 0;
-    MD_b32 parse_all = 0;
-    switch(rule)
+    MD_NodeArray result = _MD_MakeNodeArray(a.count + b.count);
+    _MD_NodeSet seen = _MD_MakeNodeSet(a.count + b.count);
+    for(MD_u64 i = 0; i < a.count + b.count; i += 1)
     {
-        default: break;
-        
-        case MD_ParseSetRule_EndOnDelimiter:
+        MD_Node *node = i < a.count ? a.v[i] : b.v[i - a.count];
+        if(_MD_NodeSetInsert(&seen, node))
         {
-            MD_u64 opener_check_off = off;
-            opener_check_off += MD_LexAdvanceFromSkips(MD_S8Skip(string, opener_check_off), MD_TokenGroup_Irregular);
-            initial_token = MD_TokenFromString(MD_S8Skip(string, opener_check_off));
-            if(initial_token.kind == MD_TokenKind_Reserved)
+            MD_NodeArrayPush(&result, node);
+        }
+    }
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeArray
+_MD_NodeArrayFromMembership(MD_NodeArray a, MD_NodeArray b, MD_b32 keep_members)
+{
+    MD_NodeArray result = _MD_MakeNodeArray(a.count);
+    _MD_NodeSet members = _MD_MakeNodeSet(b.count);
+    _MD_NodeSet seen = _MD_MakeNodeSet(a.count);
+    for(MD_u64 i = 0; i < b.count; i += 1)
+    {
+        _MD_NodeSetInsert(&members, b.v[i]);
+    }
+    for(MD_u64 i = 0; i < a.count; i += 1)
+    {
+        if(!!_MD_NodeSetContains(&members, a.v[i]) == !!keep_members && _MD_NodeSetInsert(&seen, a.v[i]))
+        {
+            MD_NodeArrayPush(&result, a.v[i]);
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayIntersect(MD_NodeArray a, MD_NodeArray b)
+{
+    return _MD_NodeArrayFromMembership(a, b, 1);
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodeArrayDifference(MD_NodeArray a, MD_NodeArray b)
+{
+    return _MD_NodeArrayFromMembership(a, b, 0);
+}
+
+//~ Tree-Wide Indexes
+
+MD_FUNCTION_IMPL MD_Index
+MD_MakeIndex(void)
+{
+    MD_Index index = MD_ZERO_STRUCT;
+    index.tag_map = MD_MapMake();
+    index.string_map = MD_MapMake();
+    index.root_rank_map = MD_MapMakeBucketCount(61);
+    return index;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_IndexRankFromRoot(MD_Index *index, MD_Node *root)
+{
+    MD_MapSlot *slot = MD_MapLookup(&index->root_rank_map, MD_MapKeyPtr(root));
+    if(slot == 0)
+    {
+        MD_u64 *rank = MD_PushArray(MD_u64, 1);
+        *rank = index->root_count;
+        index->root_count += 1;
+        slot = MD_MapInsert(&index->root_rank_map, MD_MapKeyPtr(root), rank);
+    }
+    return *(MD_u64 *)slot->val;
+}
+
+// NOTE: Negative when a comes first in document order. Ancestors come
+// before their descendants; siblings are ordered by their index fields.
+MD_PRIVATE_FUNCTION_IMPL int
+_MD_IndexCompareNodes(MD_Index *index, MD_Node *a, MD_Node *b)
+{
+    int result = 0;
+    if(a != b)
+    {
+        MD_u64 a_depth = 0;
+        MD_u64 b_depth = 0;
+        for(MD_Node *n = a; !MD_NodeIsNil(n->parent); n = n->parent) { a_depth += 1; }
+        for(MD_Node *n = b; !MD_NodeIsNil(n->parent); n = n->parent) { b_depth += 1; }
+        MD_Node *a_up = a;
+        MD_Node *b_up = b;
+        for(; a_depth > b_depth; a_depth -= 1) { a_up = a_up->parent; }
+        for(; b_depth > a_depth; b_depth -= 1) { b_up = b_up->parent; }
+        if(a_up == b_up)
+        {
+            result = (a == a_up) ? -1 : 1;
+        }
+        else
+        {
+            for(; a_up->parent != b_up->parent; a_up = a_up->parent, b_up = b_up->parent);
+            if(MD_NodeIsNil(a_up->parent))
             {
-                MD_u8 c = initial_token.raw_string.str[0];
-                if(c == '{')
-                {
-                    set_opener = '{';
-                    set_opener_flags |= MD_NodeFlag_HasBraceLeft;
-                    opener_check_off += initial_token.raw_string.size;
-                    off = opener_check_off;
-                    close_with_brace = 1;
-                }
-                else if(c == '(')
-                {
-                    set_opener = '(';
-                    set_opener_flags |= MD_NodeFlag_HasParenLeft;
-                    opener_check_off += initial_token.raw_string.size;
-                    off = opener_check_off;
-                    close_with_paren = 1;
-                }
-                else if(c == '[')
-                {
-                    set_opener = '[';
-                    set_opener_flags |= MD_NodeFlag_HasBracketLeft;
-                    opener_check_off += initial_token.raw_string.size;
-                    off = opener_check_off;
-                    close_with_paren = 1;
-                }
-                else
-                {
-                    close_with_separator = 1;
-                }
+                result = (_MD_IndexRankFromRoot(index, a_up) < _MD_IndexRankFromRoot(index, b_up)) ? -1 : 1;
             }
             else
             {
-                close_with_separator = 1;
+                result = (a_up->index < b_up->index) ? -1 : 1;
             }
-        }break;
-        
-        case MD_ParseSetRule_Global:
+        }
+    }
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeArray *
+_MD_IndexArrayFromString(MD_Map *map, MD_String8 string, MD_b32 create)
+{
+    MD_NodeArray *array = 0;
+    MD_MapSlot *slot = MD_MapLookup(map, MD_MapKeyStr(string));
+    if(slot != 0)
+    {
+        array = (MD_NodeArray *)slot->val;
+    }
+    else if(create)
+    {
+        array = MD_PushArray(MD_NodeArray, 1);
+        MD_MapInsert(map, MD_MapKeyStr(string), array);
+    }
+    return array;
+}
+
+// NOTE: Nodes usually arrive in document order, and are appended; the
+// rest are placed by binary search. A node with a repeated tag is only
+// listed once.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_IndexInsert(MD_Index *index, MD_Map *map, MD_String8 string, MD_Node *node, MD_b32 append)
+{
+    MD_NodeArray *array = _MD_IndexArrayFromString(map, string, 1);
+    if(array->count == 0 || append || _MD_IndexCompareNodes(index, array->v[array->count-1], node) < 0)
+    {
+        if(array->count == 0 || array->v[array->count-1] != node)
         {
-            parse_all = 1;
-        }break;
+            MD_NodeArrayPush(array, node);
+        }
     }
-    
-    //- rjf: fill parent data from opener
-    parent->flags |= set_opener_flags;
-    
-    //- rjf: parse children
-    MD_b32 got_closer = 0;
-    MD_u64 parsed_child_count = 0;
-    if(set_opener != 0 || close_with_separator || parse_all)
+    else
     {
-        MD_NodeFlags next_child_flags = 0;
-        for(;off < string.size;)
+        MD_u64 lo = 0;
+        MD_u64 hi = array->count;
+        for(; lo < hi;)
         {
-            
-            //- rjf: check for separator closers
-            if(close_with_separator)
-            {
-                MD_u64 closer_check_off = off;
-                
-                //- rjf: check newlines
-                {
-                    MD_Token potential_closer = MD_TokenFromString(MD_S8Skip(string, closer_check_off));
-                    if(potential_closer.kind == MD_TokenKind_Newline)
-                    {
-                        closer_check_off += potential_closer.raw_string.size;
-                        off = closer_check_off;
-                        
-                        // NOTE(rjf): always terminate with a newline if we have >0 children
-                        if(parsed_child_count > 0)
-                        {
-                            off = closer_check_off;
-                            got_closer = 1;
-                            break;
-                        }
-                        
-                        // NOTE(rjf): terminate after double newline if we have 0 children
-                        MD_Token next_closer = MD_TokenFromString(MD_S8Skip(string, closer_check_off));
-                        if(next_closer.kind == MD_TokenKind_Newline)
-                        {
-                            closer_check_off += next_closer.raw_string.size;
-                            off = closer_check_off;
-                            got_closer = 1;
-                            break;
-                        }
-                    }
-                }
-                
-                //- rjf: check separators and possible braces from higher parents
-                {
-                    closer_check_off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-                    MD_Token potential_closer = MD_TokenFromString(MD_S8Skip(string, closer_check_off));
-                    if(potential_closer.kind == MD_TokenKind_Reserved)
-                    {
-                        MD_u8 c = potential_closer.raw_string.str[0];
-                        if (c == ',' || c == ';')
-                        {
-                            closer_check_off += potential_closer.raw_string.size;
-                            off = closer_check_off;
-                            break;
-                        }
-                        else if(c == '}' || c == ']'|| c == ')')
-                        {
-                            goto end_parse;
-                        }
-                    }
-                }
-                
-            }
-            
-            //- rjf: check for non-separator closers
-            if(!close_with_separator && !parse_all)
+            MD_u64 mid = lo + (hi - lo)/2;
+            if(_MD_IndexCompareNodes(index, array->v[mid], node) < 0)
             {
-                MD_u64 closer_check_off = off;
-                closer_check_off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-                MD_Token potential_closer = MD_TokenFromString(MD_S8Skip(string, closer_check_off));
-                if(potential_closer.kind == MD_TokenKind_Reserved)
-                {
-                    MD_u8 c = potential_closer.raw_string.str[0];
-                    if(close_with_brace && c == '}')
-                    {
-                        closer_check_off += potential_closer.raw_string.size;
-                        off = closer_check_off;
-                        parent->flags |= MD_NodeFlag_HasBraceRight;
-                        got_closer = 1;
-                        break;
-                    }
-                    else if(close_with_paren && c == ']')
-                    {
-                        closer_check_off += potential_closer.raw_string.size;
-                        off = closer_check_off;
-                        parent->flags |= MD_NodeFlag_HasBracketRight;
-                        got_closer = 1;
-                        break;
-                    }
-                    else if(close_with_paren && c == ')')
-                    {
-                        closer_check_off += potential_closer.raw_string.size;
-                        off = closer_check_off;
-                        parent->flags |= MD_NodeFlag_HasParenRight;
-                        got_closer = 1;
-                        break;
-                    }
-                }
+                lo = mid + 1;
             }
-            
-            //- rjf: parse next child
-            MD_ParseResult child_parse = MD_ParseOneNode(string, off);
-            MD_MessageListConcat(&result.errors, &child_parse.errors);
-            off += child_parse.string_advance;
-            
-            //- rjf: hook child into parent
-            if(!MD_NodeIsNil(child_parse.node))
+            else
             {
-                // NOTE(rjf): @error No unnamed set children of implicitly-delimited sets
-                if(close_with_separator &&
-                   child_parse.node->string.size == 0 &&
-                   child_parse.node->flags & (MD_NodeFlag_HasParenLeft    |
-                                              MD_NodeFlag_HasParenRight   |
-                                              MD_NodeFlag_HasBracketLeft  |
-                                              MD_NodeFlag_HasBracketRight |
-                                              MD_NodeFlag_HasBraceLeft    |
-                                              MD_NodeFlag_HasBraceRight   ))
-                {
-                    MD_Message *error = MD_MakeNodeError(child_parse.node, MD_MessageKind_Warning, MD_S8Lit("Unnamed set children of implicitly-delimited sets are not legal."));
-                    MD_MessageListPush(&result.errors, error);
-                }
-                
-                MD_PushChild(parent, child_parse.node);
-                parsed_child_count += 1;
+                hi = mid;
             }
-            
-            //- rjf: check trailing separator
-            MD_NodeFlags trailing_separator_flags = 0;
-            if(!close_with_separator)
+        }
+        if(array->v[lo] != node)
+        {
+            MD_NodeArrayPush(array, node);
+            memmove(array->v + lo + 1, array->v + lo, sizeof(MD_Node *)*(array->count - 1 - lo));
+            array->v[lo] = node;
+        }
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_IndexNode(MD_Index *index, MD_Node *node, MD_Node *first_tag, MD_b32 append)
+{
+    _MD_IndexInsert(index, &index->string_map, node->string, node, append);
+    for(MD_EachNode(tag, first_tag))
+    {
+        _MD_IndexInsert(index, &index->tag_map, tag->string, node, append);
+    }
+}
+
+// NOTE: Visits node and its descendants in document order; file nodes
+// are skipped, but not their children. Sets that are not yet expanded are
+// not visited.
+#define _MD_IndexEachNode(it, node) \
+MD_Node *it = (node); !MD_NodeIsNil(it); it = _MD_IndexNextNode(it, (node))
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_IndexNextNode(MD_Node *node, MD_Node *subtree_root)
+{
+    MD_Node *next = MD_NilNode();
+    if(!MD_NodeIsNil(node->first_child))
+    {
+        next = node->first_child;
+    }
+    else
+    {
+        for(MD_Node *n = node; n != subtree_root; n = n->parent)
+        {
+            if(!MD_NodeIsNil(n->next))
             {
-                off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-                MD_Token trailing_separator = MD_TokenFromString(MD_S8Skip(string, off));
-                if (trailing_separator.kind == MD_TokenKind_Reserved){
-                    MD_u8 c = trailing_separator.string.str[0];
-                    if(c == ',')
-                    {
-                        trailing_separator_flags |= MD_NodeFlag_IsBeforeComma;
-                        off += trailing_separator.raw_string.size;
-                    }
-                    else if(c == ';')
-                    {
-                        trailing_separator_flags |= MD_NodeFlag_IsBeforeSemicolon;
-                        off += trailing_separator.raw_string.size;
-                    }
-                }
+                next = n->next;
+                break;
             }
-            
+        }
+    }
+    return next;
+}
+
+MD_FUNCTION_IMPL MD_Index
+MD_IndexFromTree(MD_Node *root)
+{
+    MD_Index index = MD_MakeIndex();
+    MD_IndexAddSubtree(&index, root);
+    return index;
+}
+
+MD_FUNCTION_IMPL void
+MD_IndexAddSubtree(MD_Index *index, MD_Node *node)
+{
+    for(_MD_IndexEachNode(n, node))
+    {
+        if(n->kind != MD_NodeKind_File)
+        {
+            _MD_IndexNode(index, n, n->first_tag, 0);
+        }
+        if(n->unexpanded != 0)
+        {
+            MD_NodeArrayPush(&index->unexpanded, n);
+        }
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_NodeIsInSubtree(MD_Node *node, MD_Node *subtree_root)
+{
+    MD_b32 result = 0;
+    for(MD_Node *n = node; !MD_NodeIsNil(n); n = n->parent)
+    {
+        if(n == subtree_root)
+        {
+            result = 1;
+            break;
+        }
+    }
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_IndexCompact(MD_Map *compacted, MD_NodeArray *array, MD_Node *subtree_root)
+{
+    if(array != 0 && MD_MapLookup(compacted, MD_MapKeyPtr(array)) == 0)
+    {
+        MD_MapInsert(compacted, MD_MapKeyPtr(array), array);
+        MD_u64 kept = 0;
+        for(MD_u64 i = 0; i < array->count; i += 1)
+        {
+            if(!_MD_NodeIsInSubtree(array->v[i], subtree_root))
+            {
+                array->v[kept] = array->v[i];
+                kept += 1;
+            }
+        }
+        array->count = kept;
+    }
+}
+
+// NOTE: May be called before or after the subtree is unlinked. Each
+// array holding one of its nodes is compacted once.
+MD_FUNCTION_IMPL void
+MD_IndexRemoveSubtree(MD_Index *index, MD_Node *node)
+{
+    MD_Map compacted = MD_MapMakeBucketCount(251);
+    for(_MD_IndexEachNode(n, node))
+    {
+        if(n->kind != MD_NodeKind_File)
+        {
+            _MD_IndexCompact(&compacted, _MD_IndexArrayFromString(&index->string_map, n->string, 0), node);
+            for(MD_EachNode(tag, n->first_tag))
+            {
+                _MD_IndexCompact(&compacted, _MD_IndexArrayFromString(&index->tag_map, tag->string, 0), node);
+            }
+        }
+    }
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodesFromTag(MD_Index *index, MD_String8 tag_string)
+{
+    MD_NodeArray result = MD_ZERO_STRUCT;
+    MD_NodeArray *array = _MD_IndexArrayFromString(&index->tag_map, tag_string, 0);
+    if(array != 0)
+    {
+        result = *array;
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodesFromString(MD_Index *index, MD_String8 string)
+{
+    MD_NodeArray result = MD_ZERO_STRUCT;
+    MD_NodeArray *array = _MD_IndexArrayFromString(&index->string_map, string, 0);
+    if(array != 0)
+    {
+        result = *array;
+    }
+    return result;
+}
+
+//~ Selectors
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_SelectorPushOp(MD_Selector *selector, MD_u64 *op_cap, MD_SelectorOpKind kind, MD_String8 string)
+{
+    if(selector->op_count == *op_cap)
+    {
+        MD_u64 new_cap = *op_cap ? *op_cap*2 : 16;
+        MD_SelectorOp *new_ops = MD_PushArray(MD_SelectorOp, new_cap);
+        MD_MemoryCopy(new_ops, selector->ops, sizeof(MD_SelectorOp)*selector->op_count);
+        selector->ops = new_ops;
+        *op_cap = new_cap;
+    }
+    selector->ops[selector->op_count].kind = kind;
+    selector->ops[selector->op_count].string = string;
+    selector->op_count += 1;
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_SelectorPushError(MD_Selector *selector, MD_String8 string, MD_u64 offset, MD_String8 error_string)
+{
+    MD_Node *marker = MD_MakeNode(MD_NodeKind_ErrorMarker, MD_S8Lit(""), string, offset);
+    MD_MessageListPush(&selector->errors, MD_MakeNodeError(marker, MD_MessageKind_Error, error_string));
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_SelectorSkipSpaces(MD_String8 string, MD_u64 off)
+{
+    for(; off < string.size && MD_CharIsSpace(string.str[off]); off += 1);
+    return off;
+}
+
+// NOTE: Names are lexed as in Metadesk, and must be identifiers,
+// numbers, or string literals. Returns the size of the name, or zero.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_SelectorLexName(MD_String8 string, MD_u64 off, MD_String8 *name_out)
+{
+    MD_u64 result = 0;
+    MD_Token token = MD_TokenFromStringWithFlags(MD_S8Skip(string, off), MD_LexFlag_UTF8);
+    if(token.kind & (MD_TokenKind_Identifier|MD_TokenKind_NumericLiteral|MD_TokenKind_StringLiteral))
+    {
+        *name_out = token.string;
+        result = token.raw_string.size;
+    }
+    return result;
+}
+
+// NOTE: Each step of the selector compiles to one op naming its axis,
+// followed by the tests that its nodes must pass:
+//
+//   selector  := ['/' | '//'] step (('/' | '//') step)*
+//   step      := (name | '*') predicate*
+//   predicate := '[' ['!'] '@' name ']'
+MD_FUNCTION_IMPL MD_Selector
+MD_SelectorFromString(MD_String8 string)
+{
+    MD_Selector selector = MD_ZERO_STRUCT;
+    MD_u64 op_cap = 0;
+    selector.step_op_indices = MD_PushArray(MD_u64, MD_SELECTOR_MAX_STEPS);
+    MD_u64 off = _MD_SelectorSkipSpaces(string, 0);
+    MD_SelectorOpKind axis = MD_SelectorOpKind_Child;
+    if(off < string.size && string.str[off] == '/')
+    {
+        off += 1;
+        if(off < string.size && string.str[off] == '/')
+        {
+            axis = MD_SelectorOpKind_Descendant;
+            off += 1;
+        }
+    }
+    for(;;)
+    {
+        //- begin step
+        off = _MD_SelectorSkipSpaces(string, off);
+        if(selector.step_count == MD_SELECTOR_MAX_STEPS)
+        {
+            _MD_SelectorPushError(&selector, string, off,
+                                  MD_S8Fmt("Selectors may have at most %d steps", MD_SELECTOR_MAX_STEPS));
+            break;
+        }
+        selector.step_op_indices[selector.step_count] = selector.op_count;
+        selector.step_count += 1;
+        _MD_SelectorPushOp(&selector, &op_cap, axis, MD_S8Lit(""));
+        
+        //- name
+        MD_String8 name = MD_ZERO_STRUCT;
+        MD_u64 name_size = _MD_SelectorLexName(string, off, &name);
+        if(off < string.size && string.str[off] == '*')
+        {
+            off += 1;
+        }
+        else if(name_size != 0)
+        {
+            _MD_SelectorPushOp(&selector, &op_cap, MD_SelectorOpKind_Name, name);
+            off += name_size;
+        }
+        else
+        {
+            _MD_SelectorPushError(&selector, string, off, MD_S8Lit("Expected a name or \"*\" in selector"));
+            break;
+        }
+        
+        //- predicates
+        for(;;)
+        {
+            off = _MD_SelectorSkipSpaces(string, off);
+            if(off >= string.size || string.str[off] != '[')
+            {
+                break;
+            }
+            MD_u64 predicate_off = off;
+            off = _MD_SelectorSkipSpaces(string, off + 1);
+            MD_SelectorOpKind kind = MD_SelectorOpKind_HasTag;
+            if(off < string.size && string.str[off] == '!')
+            {
+                kind = MD_SelectorOpKind_LacksTag;
+                off = _MD_SelectorSkipSpaces(string, off + 1);
+            }
+            MD_String8 tag = MD_ZERO_STRUCT;
+            MD_u64 tag_size = 0;
+            if(off < string.size && string.str[off] == '@')
+            {
+                tag_size = _MD_SelectorLexName(string, off + 1, &tag);
+            }
+            off = _MD_SelectorSkipSpaces(string, off + 1 + tag_size);
+            if(tag_size == 0 || off >= string.size || string.str[off] != ']')
+            {
+                _MD_SelectorPushError(&selector, string, predicate_off,
+                                      MD_S8Lit("Expected a predicate of the form \"[@tag]\" or \"[!@tag]\""));
+                break;
+            }
+            off += 1;
+            _MD_SelectorPushOp(&selector, &op_cap, kind, tag);
+        }
+        if(selector.errors.first != 0)
+        {
+            break;
+        }
+        
+        //- separator, or end
+        if(off >= string.size)
+        {
+            break;
+        }
+        if(string.str[off] != '/')
+        {
+            _MD_SelectorPushError(&selector, string, off, MD_S8Lit("Expected \"/\" between selector steps"));
+            break;
+        }
+        off += 1;
+        axis = MD_SelectorOpKind_Child;
+        if(off < string.size && string.str[off] == '/')
+        {
+            axis = MD_SelectorOpKind_Descendant;
+            off += 1;
+        }
+    }
+    return selector;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_SelectorStepMatches(MD_Selector *selector, MD_u64 step, MD_Node *node)
+{
+    MD_b32 result = 1;
+    MD_u64 first_op = selector->step_op_indices[step] + 1;
+    MD_u64 one_past_last_op = (step + 1 < selector->step_count ?
+                               selector->step_op_indices[step + 1] : selector->op_count);
+    for(MD_u64 i = first_op; result && i < one_past_last_op; i += 1)
+    {
+        MD_SelectorOp *op = &selector->ops[i];
+        switch(op->kind)
+        {
+            default: break;
+            case MD_SelectorOpKind_Name:     { result = MD_S8Match(node->string, op->string, 0); }break;
+            case MD_SelectorOpKind_HasTag:   { result = MD_NodeHasTag(node, op->string, 0); }break;
+            case MD_SelectorOpKind_LacksTag: { result = !MD_NodeHasTag(node, op->string, 0); }break;
+        }
+    }
+    return result;
+}
+
+// NOTE: The selector runs as an automaton over one preorder walk. Each
+// node carries the set of steps that its children are candidates for; a
+// child that passes a step moves on to the next, and descendant steps stay
+// in the set. Subtrees with an empty set are not walked, or expanded.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_SelectorWalk(MD_Selector *selector, MD_Node *parent, MD_u64 steps, MD_NodeArray *out)
+{
+    MD_u64 last_step = selector->step_count - 1;
+    for(MD_Node *child = MD_FirstChildFromNode(parent); !MD_NodeIsNil(child); child = child->next)
+    {
+        MD_u64 child_steps = 0;
+        MD_b32 selected = 0;
+        for(MD_u64 step = 0; step <= last_step; step += 1)
+        {
+            if(steps & (1ull << step))
+            {
+                MD_u64 axis_op = selector->step_op_indices[step];
+                if(selector->ops[axis_op].kind == MD_SelectorOpKind_Descendant)
+                {
+                    child_steps |= (1ull << step);
+                }
+                if(_MD_SelectorStepMatches(selector, step, child))
+                {
+                    if(step == last_step)
+                    {
+                        selected = 1;
+                    }
+                    else
+                    {
+                        child_steps |= (1ull << (step + 1));
+                    }
+                }
+            }
+        }
+        if(selected)
+        {
+            MD_NodeArrayPush(out, child);
+        }
+        if(child_steps != 0)
+        {
+            _MD_SelectorWalk(selector, child, child_steps, out);
+        }
+    }
+}
+
+// NOTE: Checks a node found through an index, by matching the steps
+// backwards through its ancestors, up to the node the selector started from.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_SelectorMatchesUpward(MD_Selector *selector, MD_u64 step, MD_Node *node, MD_Node *start)
+{
+    MD_b32 result = 0;
+    if(_MD_SelectorStepMatches(selector, step, node))
+    {
+        MD_b32 descendant = (selector->ops[selector->step_op_indices[step]].kind == MD_SelectorOpKind_Descendant);
+        for(MD_Node *up = node->parent; !MD_NodeIsNil(up); up = up->parent)
+        {
+            if(step == 0)
+            {
+                result = (up == start);
+            }
+            else if(up != start)
+            {
+                result = _MD_SelectorMatchesUpward(selector, step - 1, up, start);
+            }
+            if(result || !descendant || up == start)
+            {
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// NOTE: Expands every set under subtree_root that was deferred by a lazy
+// parse, so that the index holds all of its nodes. Expansions may defer
+// further sets, which are appended to the list and expanded in turn.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_IndexExpandSubtree(MD_Index *index, MD_Node *subtree_root)
+{
+    MD_u64 kept_count = 0;
+    for(MD_u64 i = 0; i < index->unexpanded.count; i += 1)
+    {
+        MD_Node *set = index->unexpanded.v[i];
+        if(set->unexpanded != 0 && _MD_NodeIsInSubtree(set, subtree_root))
+        {
+            MD_Index *set_index = set->unexpanded->options.index;
+            MD_ExpandNode(set);
+            if(set_index != index)
+            {
+                for(MD_EachNode(child, set->first_child))
+                {
+                    MD_IndexAddSubtree(index, child);
+                }
+            }
+        }
+        else if(set->unexpanded != 0)
+        {
+            index->unexpanded.v[kept_count] = set;
+            kept_count += 1;
+        }
+    }
+    index->unexpanded.count = kept_count;
+}
+
+MD_FUNCTION_IMPL MD_NodeArray
+MD_NodesFromSelector(MD_Node *node, MD_Selector *selector, MD_Index *index)
+{
+    MD_NodeArray result = MD_ZERO_STRUCT;
+    if(selector->step_count != 0 && selector->errors.max_message_kind < MD_MessageKind_Error)
+    {
+        //- find the smallest index array that the last step's nodes must be in
+        MD_NodeArray no_candidates = MD_ZERO_STRUCT;
+        MD_NodeArray *candidates = 0;
+        if(index != 0)
+        {
+            _MD_IndexExpandSubtree(index, node);
+            MD_u64 last_step = selector->step_count - 1;
+            for(MD_u64 i = selector->step_op_indices[last_step] + 1; i < selector->op_count; i += 1)
+            {
+                MD_SelectorOp *op = &selector->ops[i];
+                MD_NodeArray *array = 0;
+                if(op->kind == MD_SelectorOpKind_Name || op->kind == MD_SelectorOpKind_HasTag)
+                {
+                    MD_Map *map = (op->kind == MD_SelectorOpKind_Name) ? &index->string_map : &index->tag_map;
+                    array = _MD_IndexArrayFromString(map, op->string, 0);
+                    if(array == 0)
+                    {
+                        array = &no_candidates;
+                    }
+                }
+                if(array != 0 && (candidates == 0 || array->count < candidates->count))
+                {
+                    candidates = array;
+                }
+            }
+        }
+        
+        //- check the candidates, or walk the tree
+        if(candidates != 0)
+        {
+            for(MD_u64 i = 0; i < candidates->count; i += 1)
+            {
+                if(_MD_SelectorMatchesUpward(selector, selector->step_count - 1, candidates->v[i], node))
+                {
+                    MD_NodeArrayPush(&result, candidates->v[i]);
+                }
+            }
+        }
+        else
+        {
+            _MD_SelectorWalk(selector, node, 1, &result);
+        }
+    }
+    return result;
+}
+
+//~ Parsing
+
+// NOTE: State shared by every recursive call of one parse.
+typedef struct MD_ParseCtx MD_ParseCtx;
+struct MD_ParseCtx
+{
+    MD_ParseOptions options;
+    MD_LexFlags lex_flags;
+    MD_Node *expanding_node;
+    MD_u64 depth;
+    
+    // NOTE: The structural index of the parsed string, whether tokens are
+    // read from it, and the entry last read; see _MD_ParseToken.
+    MD_StructuralIndex *index;
+    MD_b32 index_failed;
+    MD_b32 read_index;
+    MD_u64 index_cursor;
+    
+    // NOTE: Event parsing. Nodes are built in event_nodes[depth] instead
+    // of being allocated, and are never linked into a tree.
+    MD_ParseEventCallback *event_callback;
+    void *event_user_data;
+    MD_Node *event_nodes;
+    MD_u64 event_node_count;
+    
+    // NOTE: Resource usage, checked against the limits in options. Once a
+    // limit is hit, the parse is stopped, and every parsing loop unwinds.
+    MD_u64 set_depth;
+    MD_u64 node_count;
+    MD_u64 byte_count;
+    MD_u64 step_count;
+    MD_b32 stopped;
+    MD_u64 error_count;
+    MD_b32 errors_suppressed;
+    
+    // NOTE: Nesting of tag argument lists; their nodes are not indexed.
+    MD_u64 tag_arg_depth;
+};
+
+MD_PRIVATE_FUNCTION_IMPL MD_ParseCtx
+_MD_MakeParseCtx(MD_ParseOptions *options)
+{
+    MD_ParseCtx ctx = MD_ZERO_STRUCT;
+    if(options != 0)
+    {
+        ctx.options = *options;
+    }
+    if(ctx.options.flags & MD_ParseFlag_UTF8)
+    {
+        ctx.lex_flags |= MD_LexFlag_UTF8;
+    }
+    return ctx;
+}
+
+MD_FUNCTION MD_b32
+MD_TokenGroupContainsKind(MD_TokenGroups groups, MD_TokenKind kind)
+{
+    return (groups & kind) != 0;
+}
+
+// NOTE: Without the full Unicode tables, every code point is treated as
+// a letter, except for those in the blocks that hold only punctuation,
+// symbols, spaces, and private use characters.
+MD_GLOBAL MD_u32 _md_non_identifier_codepoint_ranges[][2] =
+{
+    {0x0080, 0x00A9}, {0x00AB, 0x00B4}, {0x00B6, 0x00B9}, {0x00BB, 0x00BF},
+    {0x00D7, 0x00D7}, {0x00F7, 0x00F7},
+    {0x2000, 0x206F}, {0x20A0, 0x20CF}, {0x2190, 0x2BFF}, {0x2E00, 0x2E7F},
+    {0x3000, 0x3004}, {0x3008, 0x3020}, {0x3030, 0x3030},
+    {0xE000, 0xF8FF},
+    {0xFE10, 0xFE1F}, {0xFE30, 0xFE6F}, {0xFEFF, 0xFEFF},
+    {0xFF00, 0xFF0F}, {0xFF1A, 0xFF20}, {0xFF3B, 0xFF40}, {0xFF5B, 0xFF65},
+    {0xFFF0, 0xFFFF},
+    {0x1F000, 0x1FAFF}, {0xE0000, 0x10FFFF},
+};
+
+// NOTE: Returns the size of the code point at 'at', or 0 if it is not
+// valid UTF-8. Overlong encodings and surrogates are not valid.
+MD_PRIVATE_FUNCTION_IMPL MD_u32
+_MD_UTF8CodepointSize(MD_u8 *at, MD_u8 *one_past_last, MD_u32 *codepoint_out)
+{
+    MD_u32 result = 0;
+    MD_DecodedCodepoint decoded = MD_DecodeCodepointFromUtf8(at, (MD_u64)(one_past_last - at));
+    MD_u32 c = decoded.codepoint;
+    MD_u32 min_for_size[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if(c != ~((MD_u32)0) && decoded.advance <= 4 &&
+       c >= min_for_size[decoded.advance] && c <= 0x10FFFF &&
+       !(c >= 0xD800 && c <= 0xDFFF))
+    {
+        result = decoded.advance;
+        *codepoint_out = c;
+    }
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_CodepointIsIdentifierChar(MD_u32 c)
+{
+    MD_b32 result = 1;
+    for(MD_u64 i = 0; i < MD_ArrayCount(_md_non_identifier_codepoint_ranges); i += 1)
+    {
+        if(_md_non_identifier_codepoint_ranges[i][0] <= c && c <= _md_non_identifier_codepoint_ranges[i][1])
+        {
+            result = 0;
+            break;
+        }
+    }
+    return result;
+}
+
+// NOTE: Returns the size of the non-ASCII identifier character at 'at',
+// or 0 if there is none.
+MD_PRIVATE_FUNCTION_IMPL MD_u32
+_MD_UTF8IdentifierCharSize(MD_u8 *at, MD_u8 *one_past_last)
+{
+    MD_u32 result = 0;
+    MD_u32 codepoint = 0;
+    if(*at >= 0x80)
+    {
+        result = _MD_UTF8CodepointSize(at, one_past_last, &codepoint);
+        if(result != 0 && !_MD_CodepointIsIdentifierChar(codepoint))
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+// NOTE: Returns the length of the run of ASCII identifier characters at
+// 'first', 16 bytes at a time where possible.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_IdentifierCharRunLength(MD_u8 *first, MD_u8 *one_past_last)
+{
+    MD_u8 *at = first;
+#if MD_ARCH_X64
+    for(; at + 16 <= one_past_last;)
+    {
+        __m128i block = _mm_loadu_si128((__m128i *)at);
+        __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+        __m128i hits = _MD_BytesInRange16(folded, 'a', 'z');
+        hits = _mm_or_si128(hits, _MD_BytesInRange16(block, '0', '9'));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+        MD_u32 misses = ~(MD_u32)_mm_movemask_epi8(hits) & 0xFFFF;
+        if(misses != 0)
+        {
+            return (MD_u64)(at - first) + _MD_CountTrailingZeros64(misses);
+        }
+        at += 16;
+    }
+#endif
+    for(; at < one_past_last && (MD_CharIsAlpha(*at) || MD_CharIsDigit(*at) || *at == '_'); at += 1);
+    return (MD_u64)(at - first);
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeFlags
+_MD_NodeFlagsFromStringDelimiter(MD_u8 d, MD_b32 is_triplet)
+{
+    MD_NodeFlags flags = MD_NodeFlag_StringLiteral;
+    switch(d)
+    {
+        case '\'': flags |= MD_NodeFlag_StringSingleQuote; break;
+        case '"':  flags |= MD_NodeFlag_StringDoubleQuote; break;
+        case '`':  flags |= MD_NodeFlag_StringTick; break;
+        default: break;
+    }
+    if(is_triplet)
+    {
+        flags |= MD_NodeFlag_StringTriplet;
+    }
+    return flags;
+}
+
+MD_FUNCTION_IMPL MD_Token
+MD_TokenFromString(MD_String8 string)
+{
+    return MD_TokenFromStringWithFlags(string, 0);
+}
+
+MD_FUNCTION_IMPL MD_Token
+MD_TokenFromStringWithFlags(MD_String8 string, MD_LexFlags flags)
+{
+    MD_Token token = MD_ZERO_STRUCT;
+    MD_b32 utf8 = !!(flags & MD_LexFlag_UTF8);
+    MD_u32 utf8_char_size = 0;
+
+    MD_u8 *one_past_last = string.str + string.size;
+    MD_u8 *first = string.str;
+    
+    if(first < one_past_last)
+    {
+        MD_u8 *at = first;
+        MD_u32 skip_n = 0;
+        MD_u32 chop_n = 0;
+        
+#define MD_TokenizerScan(cond) for (; at < one_past_last && (cond); at += 1)
+        
+        switch (*at)
+        {
+            // NOTE(allen): Whitespace parsing
+            case '\n':
+            {
+                token.kind = MD_TokenKind_Newline;
+                at += 1;
+            }break;
+            
+            case ' ': case '\r': case '\t': case '\f': case '\v':
+            {
+                token.kind = MD_TokenKind_Whitespace;
+                at += 1;
+                MD_TokenizerScan(*at == ' ' || *at == '\r' || *at == '\t' || *at == '\f' || *at == '\v');
+            }break;
+            
+            // NOTE(allen): Comment parsing
+            case '/':
+            {
+                if (at + 1 < one_past_last)
+                {
+                    if (at[1] == '/')
+                    {
+                        // trim off the first '//'
+                        skip_n = 2;
+                        at += 2;
+                        token.kind = MD_TokenKind_Comment;
+                        MD_TokenizerScan(*at != '\n' && *at != '\r');
+                    }
+                    else if (at[1] == '*')
+                    {
+                        // trim off the first '/*'
+                        skip_n = 2;
+                        at += 2;
+                        token.kind = MD_TokenKind_BrokenComment;
+                        int counter = 1;
+                        for (;at < one_past_last && counter > 0; at += 1)
+                        {
+                            if (at + 1 < one_past_last)
+                            {
+                                if (at[0] == '*' && at[1] == '/')
+                                {
+                                    at += 1;
+                                    counter -= 1;
+                                }
+                                else if (at[0] == '/' && at[1] == '*')
+                                {
+                                    at += 1;
+                                    counter += 1;
+                                }
+                            }
+                        }
+                        if(counter == 0)
+                        {
+                            token.kind = MD_TokenKind_Comment;
+                            chop_n = 2;
+                        }
+                    }
+                }
+                if (token.kind == 0) goto symbol_lex;
+            }break;
+            
+            // NOTE(allen): Strings
+            case '"':
+            case '\'':
+            case '`':
+            {
+                token.kind = MD_TokenKind_BrokenStringLiteral;
+                
+                // determine delimiter setup
+                MD_u8 d = *at;
+                MD_b32 is_triplet = (at + 2 < one_past_last && at[1] == d && at[2] == d);
+                
+                // lex triple-delimiter string
+                if (is_triplet)
+                {
+                    skip_n = 3;
+                    at += 3;
+                    MD_u32 consecutive_d = 0;
+                    for (;;)
+                    {
+                        // fail condition
+                        if (at >= one_past_last){
+                            break;
+                        }
+                        
+                        if(at[0] == d)
+                        {
+                            consecutive_d += 1;
+                            at += 1;
+                            // close condition
+                            if (consecutive_d == 3){
+                                chop_n = 3;
+                                token.kind = MD_TokenKind_StringLiteral;
+                                break;
+                            }
+                        }
+                        else
+                        {
+                            consecutive_d = 0;
+                            
+                            // escaping rule
+                            if(at[0] == '\\')
+                            {
+                                at += 1;
+                                if(at < one_past_last && (at[0] == d || at[0] == '\\'))
+                                {
+                                    at += 1;
+                                }
+                            }
+                            else{
+                                at += 1;
+                            }
+                        }
+                    }
+                }
+                
+                // lex single-delimiter string
+                if (!is_triplet)
+                {
+                    skip_n = 1;
+                    at += 1;
+                    for (;at < one_past_last;)
+                    {
+                        // close condition
+                        if (*at == d){
+                            at += 1;
+                            chop_n = 1;
+                            token.kind = MD_TokenKind_StringLiteral;
+                            break;
+                        }
+                        
+                        // fail condition
+                        if (*at == '\n'){
+                            break;
+                        }
+                        
+                        // escaping rule
+                        if (at[0] == '\\'){
+                            at += 1;
+                            if (at < one_past_last && (at[0] == d || at[0] == '\\')){
+                                at += 1;
+                            }
+                        }
+                        else{
+                            at += 1;
+                        }
+                    }
+                }
+                
+                //- rjf: set relevant node flags on token
+                token.node_flags |= _MD_NodeFlagsFromStringDelimiter(d, is_triplet);
+                
+            }break;
+            
+            // NOTE(allen): Identifiers, Numbers, Operators
+            default:
+            {
+                if (MD_CharIsAlpha(*at) || *at == '_' ||
+                    (utf8 && (utf8_char_size = _MD_UTF8IdentifierCharSize(at, one_past_last)) != 0))
+                {
+                    token.node_flags |= MD_NodeFlag_Identifier;
+                    token.kind = MD_TokenKind_Identifier;
+                    at += (utf8_char_size != 0 ? utf8_char_size : 1);
+                    for (;;)
+                    {
+                        at += _MD_IdentifierCharRunLength(at, one_past_last);
+                        if (!utf8 || at >= one_past_last ||
+                            (utf8_char_size = _MD_UTF8IdentifierCharSize(at, one_past_last)) == 0)
+                        {
+                            break;
+                        }
+                        at += utf8_char_size;
+                    }
+                }
+                
+                else if (MD_CharIsDigit(*at))
+                {
+                    token.node_flags |= MD_NodeFlag_Numeric;
+                    token.kind = MD_TokenKind_NumericLiteral;
+                    at += 1;
+                    
+                    for (; at < one_past_last;){
+                        MD_b32 good = 0;
+                        if (*at == 'e' || *at == 'E'){
+                            good = 1;
+                            at += 1;
+                            if (at < one_past_last &&
+                                (*at == '+' || *at == '-')){
+                                at += 1;
+                            }
+                        }
+                        else if (MD_CharIsAlpha(*at) || MD_CharIsDigit(*at) || *at == '.'){
+                            good = 1;
+                            at += 1;
+                        }
+                        if (!good){
+                            break;
+                        }
+                    }
+                }
+                
+                else if (MD_CharIsUnreservedSymbol(*at))
+                {
+                    symbol_lex:
+                    token.kind = MD_TokenKind_Symbol;
+                    at += 1;
+                }
+                
+                else if (MD_CharIsReservedSymbol(*at))
+                {
+                    token.kind = MD_TokenKind_Reserved;
+                    at += 1;
+                }
+                
+                else
+                {
+                    token.kind = MD_TokenKind_BadCharacter;
+                    MD_u32 codepoint = 0;
+                    MD_u32 size = utf8 ? _MD_UTF8CodepointSize(at, one_past_last, &codepoint) : 0;
+                    at += (size != 0 ? size : 1);
+                }
+            }break;
+        }
+        
+        token.raw_string = MD_S8Range(first, at);
+        token.string = MD_S8Substring(token.raw_string, skip_n, token.raw_string.size - chop_n);
+        
+#undef MD_TokenizerScan
+        
+    }
+    
+    return token;
+}
+
+MD_FUNCTION_IMPL MD_u64
+MD_LexAdvanceFromSkips(MD_String8 string, MD_TokenKind skip_kinds)
+{
+    MD_u64 result = string.size;
+    MD_u64 p = 0;
+    for (;;)
+    {
+        MD_Token token = MD_TokenFromString(MD_S8Skip(string, p));
+        if ((skip_kinds & token.kind) == 0)
+        {
+            result = p;
+            break;
+        }
+        p += token.raw_string.size;
+    }
+    return(result);
+}
+
+MD_FUNCTION_IMPL MD_Message *
+MD_MakeNodeError(MD_Node *node, MD_MessageKind kind, MD_String8 str)
+{
+    MD_Message *error = MD_PushArrayZero(MD_Message, 1);
+    error->node = node;
+    error->kind = kind;
+    error->string = str;
+    return error;
+}
+
+MD_FUNCTION_IMPL MD_Message *
+MD_MakeTokenError(MD_String8 parse_contents, MD_Token token, MD_MessageKind kind, MD_String8 str)
+{
+    MD_Node *err_node = MD_MakeNode(MD_NodeKind_ErrorMarker, MD_S8Lit(""), parse_contents,
+                                    token.raw_string.str - parse_contents.str);
+    err_node->end_offset = err_node->offset + token.raw_string.size;
+    return MD_MakeNodeError(err_node, kind, str);
+}
+
+MD_FUNCTION_IMPL void
+MD_MessageListPush(MD_MessageList *list, MD_Message *message)
+{
+    MD_QueuePush(list->first, list->last, message);
+    if(message->kind > list->max_message_kind)
+    {
+        list->max_message_kind = message->kind;
+    }
+    list->node_count += 1;
+}
+
+MD_FUNCTION_IMPL void
+MD_MessageListConcat(MD_MessageList *list, MD_MessageList *to_push)
+{
+    if(list->last)
+    {
+        if(to_push->node_count != 0)
+        {
+            list->last->next = to_push->first;
+            list->last = to_push->last;
+            list->node_count += to_push->node_count;
+        }
+        // NOTE: An empty list may still carry the kind of suppressed messages.
+        if(to_push->max_message_kind > list->max_message_kind)
+        {
+            list->max_message_kind = to_push->max_message_kind;
+        }
+    }
+    else
+    {
+        *list = *to_push;
+    }
+    MD_MemoryZero(to_push, sizeof(*to_push));
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseResultZero(void)
+{
+    MD_ParseResult result = MD_ZERO_STRUCT;
+    result.node = result.last_node = MD_NilNode();
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_InitNode(MD_Node *node, MD_NodeKind kind, MD_String8 string, MD_String8 raw_string, MD_u64 offset)
+{
+    MD_MemoryZero(node, sizeof(*node));
+    node->kind = kind;
+    node->string = string;
+    node->raw_string = raw_string;
+    node->next = node->prev = node->parent =
+        node->first_child = node->last_child =
+        node->first_tag = node->last_tag = node->ref_target = MD_NilNode();
+    node->offset = offset;
+    node->end_offset = offset + raw_string.size;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_ParseMakeNode(MD_ParseCtx *ctx, MD_NodeKind kind, MD_String8 string, MD_String8 raw_string, MD_u64 offset)
+{
+    MD_Node *node = 0;
+    if(ctx->event_callback != 0 && ctx->depth < ctx->event_node_count)
+    {
+        node = &ctx->event_nodes[ctx->depth];
+        _MD_InitNode(node, kind, string, raw_string, offset);
+    }
+    else
+    {
+        node = MD_MakeNode(kind, string, raw_string, offset);
+        ctx->byte_count += sizeof(MD_Node);
+    }
+    ctx->node_count += 1;
+    return node;
+}
+
+// NOTE: Nodes are built in document order, before they are linked into
+// the tree, so they are appended to the index without being compared. Nodes
+// from an expansion are indexed by MD_ExpandNode instead.
+MD_PRIVATE_FUNCTION_IMPL MD_Index *
+_MD_IndexFromParseCtx(MD_ParseCtx *ctx)
+{
+    MD_Index *index = 0;
+    if(ctx->event_callback == 0 && ctx->tag_arg_depth == 0 && ctx->expanding_node == 0)
+    {
+        index = ctx->options.index;
+    }
+    return index;
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_IndexParsedNode(MD_ParseCtx *ctx, MD_Node *node, MD_Node *first_tag)
+{
+    MD_Index *index = _MD_IndexFromParseCtx(ctx);
+    if(index != 0)
+    {
+        _MD_IndexNode(index, node, first_tag, 1);
+        
+        // NOTE: Each string may take a new slot and array, and arrays
+        // grow by doubling, so this bounds what each listing allocates.
+        MD_u64 listing_count = 1;
+        for(MD_EachNode(tag, first_tag))
+        {
+            listing_count += 1;
+        }
+        ctx->byte_count += listing_count*(2*sizeof(MD_Node *) + sizeof(MD_MapSlot) + sizeof(MD_NodeArray));
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_SendParseEvent(MD_ParseCtx *ctx, MD_ParseEventKind kind, MD_u64 depth, MD_Node *node,
+                   MD_String8 string, MD_u64 offset, MD_Message *message)
+{
+    if(ctx->event_callback != 0)
+    {
+        MD_ParseEvent event = MD_ZERO_STRUCT;
+        event.kind = kind;
+        event.depth = depth;
+        event.node = node;
+        event.string = string;
+        event.offset = offset;
+        event.message = message;
+        ctx->event_callback(&event, ctx->event_user_data);
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_SendNodeEvent(MD_ParseCtx *ctx, MD_ParseEventKind kind, MD_u64 depth, MD_Node *node)
+{
+    _MD_SendParseEvent(ctx, kind, depth, node, node->string, node->offset, 0);
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_PushParseError(MD_ParseCtx *ctx, MD_MessageList *list, MD_Message *error)
+{
+    ctx->byte_count += sizeof(MD_Message) + sizeof(MD_Node) + error->string.size + 1;
+    ctx->error_count += 1;
+    MD_MessageListPush(list, error);
+    _MD_SendParseEvent(ctx, MD_ParseEventKind_Error, ctx->depth - 1, error->node,
+                       error->string, error->node->offset, error);
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32 _MD_BuildStructuralIndex(MD_String8 string, MD_u64 max_byte_count,
+                                                         MD_StructuralIndex *index_out, MD_u64 *byte_count);
+MD_PRIVATE_FUNCTION_IMPL MD_Token _MD_TokenFromStructuralEntry(MD_StructuralIndex *index, MD_String8 string,
+                                                               MD_u64 entry);
+MD_PRIVATE_FUNCTION_IMPL MD_b32 _MD_CharIsStructuralCandidate(MD_u8 c);
+
+// NOTE: The index is built at most once per parse, and is shared with
+// every expansion. It is charged against max_byte_count like the rest of the
+// parse; if it does not fit in what is left, the parse goes on without it, and
+// runs into the limit as it goes.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_BuildParseIndex(MD_ParseCtx *ctx, MD_String8 string)
+{
+    if(ctx->index == 0 && !ctx->index_failed)
+    {
+        MD_u64 max_byte_count = ctx->options.max_byte_count;
+        MD_u64 budget = 0;
+        if(max_byte_count != 0)
+        {
+            budget = (ctx->byte_count < max_byte_count) ? max_byte_count - ctx->byte_count : 1;
+        }
+        MD_StructuralIndex *index = MD_PushArray(MD_StructuralIndex, 1);
+        ctx->byte_count += sizeof(MD_StructuralIndex);
+        if(_MD_BuildStructuralIndex(string, budget, index, &ctx->byte_count))
+        {
+            ctx->index = index;
+        }
+        else
+        {
+            ctx->index_failed = 1;
+        }
+    }
+}
+
+// NOTE: Reading tokens from the index saves rescanning strings and
+// comments each time the parser looks at them, but the index takes a pass to
+// build, and an entry costs more to read than a short token costs to lex. It
+// pays once strings and comments average a dozen bytes per entry, which is
+// judged from a sample at the start of the string; strings shorter than the
+// sample are not worth indexing.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_ParseShouldReadIndex(MD_String8 string)
+{
+    MD_b32 result = 0;
+    MD_u64 sample_size = 64*1024;
+    if(string.size >= sample_size)
+    {
+        MD_String8 sample = MD_S8Prefix(string, sample_size);
+        MD_u64 entry_count = 0;
+        MD_u64 scanned_byte_count = 0;
+        for(MD_u64 off = 0; off < sample.size;)
+        {
+            MD_Token token = MD_TokenFromString(MD_S8Skip(sample, off));
+            if(token.kind & (MD_TokenKind_StringLiteral|MD_TokenKind_BrokenStringLiteral|
+                             MD_TokenKind_Comment|MD_TokenKind_BrokenComment))
+            {
+                entry_count += 1;
+                scanned_byte_count += token.raw_string.size;
+            }
+            else if(token.kind & (MD_TokenKind_Reserved|MD_TokenKind_Newline))
+            {
+                entry_count += 1;
+            }
+            off += token.raw_string.size;
+        }
+        result = (scanned_byte_count >= 12*entry_count);
+    }
+    return result;
+}
+
+// NOTE: Reserved symbols, newlines, strings, and comments are read from
+// the index rather than the lexer, so their bytes are scanned once, when the
+// index is built; everything else, which lies between entries, is lexed. Reads
+// mostly move forward, so the entry after the last one read is tried before
+// searching.
+MD_PRIVATE_FUNCTION_IMPL MD_Token
+_MD_ParseTokenFromIndex(MD_ParseCtx *ctx, MD_String8 string, MD_u64 off, MD_LexFlags flags)
+{
+    MD_Token token = MD_ZERO_STRUCT;
+    MD_StructuralIndex *index = ctx->index;
+    MD_b32 found = 0;
+    if(index != 0 && off < string.size && _MD_CharIsStructuralCandidate(string.str[off]))
+    {
+        MD_u64 entry = ctx->index_cursor;
+        if(entry < index->count && index->offsets[entry] != off)
+        {
+            entry += 1;
+        }
+        if(entry >= index->count || index->offsets[entry] != off)
+        {
+            entry = MD_StructuralIndexEntryFromOffset(index, off);
+        }
+        if(entry < index->count && index->offsets[entry] == off)
+        {
+            ctx->index_cursor = entry;
+            token = _MD_TokenFromStructuralEntry(index, string, entry);
+            found = 1;
+        }
+    }
+    if(!found)
+    {
+        token = MD_TokenFromStringWithFlags(MD_S8Skip(string, off), flags);
+    }
+    return token;
+}
+
+// NOTE: Every token the parser reads comes from here. A macro, so that
+// parses which do not read from an index call the lexer as directly as they
+// would without one.
+#define _MD_ParseToken(ctx, string, off, flags) ((ctx)->read_index ?                                  \
+                                                 _MD_ParseTokenFromIndex((ctx), (string), (off), (flags)) : \
+                                                 MD_TokenFromStringWithFlags(MD_S8Skip((string), (off)), (flags)))
+
+// NOTE: MD_LexAdvanceFromSkips, reading tokens with _MD_ParseToken.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_ParseAdvanceFromSkips(MD_ParseCtx *ctx, MD_String8 string, MD_u64 off, MD_TokenKind skip_kinds)
+{
+    MD_u64 p = off;
+    for(;;)
+    {
+        MD_Token token = _MD_ParseToken(ctx, string, p, 0);
+        if((skip_kinds & token.kind) == 0)
+        {
+            break;
+        }
+        p += token.raw_string.size;
+    }
+    return p - off;
+}
+
+// NOTE: Checked before an error is built, so that errors past the cap
+// cost nothing. The first error past the cap is replaced by a note saying that
+// the rest are not reported; suppressed errors still raise max_message_kind.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_ParseErrorIsWanted(MD_ParseCtx *ctx, MD_MessageList *list, MD_MessageKind kind,
+                       MD_String8 string, MD_u64 offset)
+{
+    MD_b32 result = 1;
+    MD_u64 max_error_count = ctx->options.max_error_count;
+    if(max_error_count != 0 && ctx->error_count >= max_error_count)
+    {
+        result = 0;
+        if(!ctx->errors_suppressed)
+        {
+            ctx->errors_suppressed = 1;
+            MD_Token token = _MD_ParseToken(ctx, string, offset, 0);
+            MD_Message *note = MD_MakeTokenError(string, token, MD_MessageKind_Note,
+                                                 MD_S8Lit("Too many errors; further errors are not reported"));
+            _MD_PushParseError(ctx, list, note);
+        }
+        if(kind > list->max_message_kind)
+        {
+            list->max_message_kind = kind;
+        }
+    }
+    return result;
+}
+
+// NOTE: Skipping a set is a lookup in the structural index, which is
+// built on the first set skipped, if the parse did not build it up front.
+// Returns 0 if the set is not closed, or cannot be deferred.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_FindSetCloser(MD_ParseCtx *ctx, MD_String8 string, MD_u64 opener_off, MD_u64 *closer_off_out)
+{
+    MD_b32 result = 0;
+    _MD_BuildParseIndex(ctx, string);
+    MD_StructuralIndex *index = ctx->index;
+    MD_u64 opener_entry = (index != 0) ? MD_StructuralIndexEntryFromOffset(index, opener_off) : 0;
+    if(index != 0 && opener_entry < index->count && index->offsets[opener_entry] == opener_off &&
+       index->partners[opener_entry] > opener_entry)
+    {
+        *closer_off_out = index->offsets[index->partners[opener_entry]];
+        result = 1;
+    }
+    return result;
+}
+
+// NOTE: Called once per step of every parsing loop. Returns 1 once the
+// parse is stopped; the first call to find a limit exceeded reports it.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_CheckParseLimits(MD_ParseCtx *ctx, MD_MessageList *errors, MD_String8 string, MD_u64 offset)
+{
+    if(!ctx->stopped)
+    {
+        MD_ParseOptions *options = &ctx->options;
+        char *limit_name = 0;
+        ctx->step_count += 1;
+        if(options->max_depth != 0 && ctx->set_depth > options->max_depth)
+        {
+            limit_name = "depth";
+        }
+        else if(options->max_node_count != 0 && ctx->node_count >= options->max_node_count)
+        {
+            limit_name = "node";
+        }
+        else if(options->max_byte_count != 0 && ctx->byte_count >= options->max_byte_count)
+        {
+            limit_name = "memory";
+        }
+        else if(options->max_step_count != 0 && ctx->step_count > options->max_step_count)
+        {
+            limit_name = "step";
+        }
+        if(limit_name != 0)
+        {
+            // NOTE: @error Parse limit exceeded
+            ctx->stopped = 1;
+            MD_Token token = _MD_ParseToken(ctx, string, offset, 0);
+            MD_Message *error = MD_MakeTokenError(string, token, MD_MessageKind_CatastrophicError,
+                                                  MD_S8Fmt("Parse stopped: %s limit exceeded", limit_name));
+            _MD_PushParseError(ctx, errors, error);
+        }
+    }
+    return ctx->stopped;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult _MD_ParseOneNode(MD_ParseCtx *ctx, MD_String8 string, MD_u64 offset);
+
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult
+_MD_ParseNodeSet(MD_ParseCtx *ctx, MD_String8 string, MD_u64 offset, MD_Node *parent, MD_ParseSetRule rule)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    MD_u64 off = offset;
+    
+    //- rjf: fill data from set opener
+    MD_Token initial_token = _MD_ParseToken(ctx, string, offset, 0);
+    MD_u8 set_opener = 0;
+    MD_NodeFlags set_opener_flags = 0;
+    MD_b32 close_with_brace = 0;
+    MD_b32 close_with_paren = 0;
+    MD_b32 close_with_separator = 0;
+    MD_b32 parse_all = 0;
+    switch(rule)
+    {
+        default: break;
+        
+        case MD_ParseSetRule_EndOnDelimiter:
+        {
+            MD_u64 opener_check_off = off;
+            opener_check_off += _MD_ParseAdvanceFromSkips(ctx, string, opener_check_off, MD_TokenGroup_Irregular);
+            initial_token = _MD_ParseToken(ctx, string, opener_check_off, 0);
+            if(initial_token.kind == MD_TokenKind_Reserved)
+            {
+                MD_u8 c = initial_token.raw_string.str[0];
+                if(c == '{')
+                {
+                    set_opener = '{';
+                    set_opener_flags |= MD_NodeFlag_HasBraceLeft;
+                    opener_check_off += initial_token.raw_string.size;
+                    off = opener_check_off;
+                    close_with_brace = 1;
+                }
+                else if(c == '(')
+                {
+                    set_opener = '(';
+                    set_opener_flags |= MD_NodeFlag_HasParenLeft;
+                    opener_check_off += initial_token.raw_string.size;
+                    off = opener_check_off;
+                    close_with_paren = 1;
+                }
+                else if(c == '[')
+                {
+                    set_opener = '[';
+                    set_opener_flags |= MD_NodeFlag_HasBracketLeft;
+                    opener_check_off += initial_token.raw_string.size;
+                    off = opener_check_off;
+                    close_with_paren = 1;
+                }
+                else
+                {
+                    close_with_separator = 1;
+                }
+            }
+            else
+            {
+                close_with_separator = 1;
+            }
+        }break;
+        
+        case MD_ParseSetRule_Global:
+        {
+            parse_all = 1;
+        }break;
+    }
+    
+    //- rjf: fill parent data from opener
+    parent->flags |= set_opener_flags;
+    MD_b32 send_set_events = (rule != MD_ParseSetRule_Global);
+    if(send_set_events)
+    {
+        _MD_SendNodeEvent(ctx, MD_ParseEventKind_BeginSet, ctx->depth - 1, parent);
+        ctx->set_depth += 1;
+    }
+    ctx->depth += 1;
+    
+    //- rjf: parse children
+    MD_b32 got_closer = 0;
+    MD_u64 parsed_child_count = 0;
+    MD_u64 last_child_end = 0;
+    if(_MD_CheckParseLimits(ctx, &result.errors, string, off))
+    {
+        goto end_parse;
+    }
+    
+    //- defer children of delimited sets, when parsing lazily
+    if(set_opener != 0 && ctx->options.flags & MD_ParseFlag_LazySets && ctx->event_callback == 0 &&
+       parent->kind != MD_NodeKind_Tag && parent != ctx->expanding_node)
+    {
+        MD_u64 closer_off = 0;
+        if(_MD_FindSetCloser(ctx, string, off - 1, &closer_off))
+        {
+            MD_u8 c = string.str[closer_off];
+            parent->flags |= (c == '}' ? MD_NodeFlag_HasBraceRight :
+                              c == ']' ? MD_NodeFlag_HasBracketRight :
+                              MD_NodeFlag_HasParenRight);
+            MD_UnexpandedSet *unexpanded = MD_PushArray(MD_UnexpandedSet, 1);
+            unexpanded->contents = string;
+            unexpanded->offset = offset;
+            unexpanded->options = ctx->options;
+            unexpanded->index = ctx->index;
+            unexpanded->read_index = ctx->read_index;
+            parent->unexpanded = unexpanded;
+            ctx->byte_count += sizeof(MD_UnexpandedSet);
+            MD_Index *index = _MD_IndexFromParseCtx(ctx);
+            if(index != 0)
+            {
+                MD_NodeArrayPush(&index->unexpanded, parent);
+            }
+            off = closer_off + 1;
+            got_closer = 1;
+            goto end_parse;
+        }
+    }
+    
+    if(set_opener != 0 || close_with_separator || parse_all)
+    {
+        MD_NodeFlags next_child_flags = 0;
+        for(;off < string.size;)
+        {
+            if(_MD_CheckParseLimits(ctx, &result.errors, string, off))
+            {
+                break;
+            }
+            
+            //- rjf: check for separator closers
+            if(close_with_separator)
+            {
+                MD_u64 closer_check_off = off;
+                
+                //- rjf: check newlines
+                {
+                    MD_Token potential_closer = _MD_ParseToken(ctx, string, closer_check_off, 0);
+                    if(potential_closer.kind == MD_TokenKind_Newline)
+                    {
+                        closer_check_off += potential_closer.raw_string.size;
+                        off = closer_check_off;
+                        
+                        // NOTE(rjf): always terminate with a newline if we have >0 children
+                        if(parsed_child_count > 0)
+                        {
+                            off = closer_check_off;
+                            got_closer = 1;
+                            break;
+                        }
+                        
+                        // NOTE(rjf): terminate after double newline if we have 0 children
+                        MD_Token next_closer = _MD_ParseToken(ctx, string, closer_check_off, 0);
+                        if(next_closer.kind == MD_TokenKind_Newline)
+                        {
+                            closer_check_off += next_closer.raw_string.size;
+                            off = closer_check_off;
+                            got_closer = 1;
+                            break;
+                        }
+                    }
+                }
+                
+                //- rjf: check separators and possible braces from higher parents
+                {
+                    closer_check_off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+                    MD_Token potential_closer = _MD_ParseToken(ctx, string, closer_check_off, 0);
+                    if(potential_closer.kind == MD_TokenKind_Reserved)
+                    {
+                        MD_u8 c = potential_closer.raw_string.str[0];
+                        if (c == ',' || c == ';')
+                        {
+                            closer_check_off += potential_closer.raw_string.size;
+                            off = closer_check_off;
+                            break;
+                        }
+                        else if(c == '}' || c == ']'|| c == ')')
+                        {
+                            goto end_parse;
+                        }
+                    }
+                }
+                
+            }
+            
+            //- rjf: check for non-separator closers
+            if(!close_with_separator && !parse_all)
+            {
+                MD_u64 closer_check_off = off;
+                closer_check_off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+                MD_Token potential_closer = _MD_ParseToken(ctx, string, closer_check_off, 0);
+                if(potential_closer.kind == MD_TokenKind_Reserved)
+                {
+                    MD_u8 c = potential_closer.raw_string.str[0];
+                    if(close_with_brace && c == '}')
+                    {
+                        closer_check_off += potential_closer.raw_string.size;
+                        off = closer_check_off;
+                        parent->flags |= MD_NodeFlag_HasBraceRight;
+                        got_closer = 1;
+                        break;
+                    }
+                    else if(close_with_paren && c == ']')
+                    {
+                        closer_check_off += potential_closer.raw_string.size;
+                        off = closer_check_off;
+                        parent->flags |= MD_NodeFlag_HasBracketRight;
+                        got_closer = 1;
+                        break;
+                    }
+                    else if(close_with_paren && c == ')')
+                    {
+                        closer_check_off += potential_closer.raw_string.size;
+                        off = closer_check_off;
+                        parent->flags |= MD_NodeFlag_HasParenRight;
+                        got_closer = 1;
+                        break;
+                    }
+                }
+            }
+            
+            //- rjf: parse next child
+            MD_ParseResult child_parse = _MD_ParseOneNode(ctx, string, off);
+            MD_MessageListConcat(&result.errors, &child_parse.errors);
+            off += child_parse.string_advance;
+            
+            //- rjf: hook child into parent
+            if(!MD_NodeIsNil(child_parse.node))
+            {
+                // NOTE(rjf): @error No unnamed set children of implicitly-delimited sets
+                if(close_with_separator &&
+                   child_parse.node->string.size == 0 &&
+                   child_parse.node->flags & (MD_NodeFlag_HasParenLeft    |
+                                              MD_NodeFlag_HasParenRight   |
+                                              MD_NodeFlag_HasBracketLeft  |
+                                              MD_NodeFlag_HasBracketRight |
+                                              MD_NodeFlag_HasBraceLeft    |
+                                              MD_NodeFlag_HasBraceRight   ) &&
+                   _MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_Warning,
+                                          string, child_parse.node->offset))
+                {
+                    MD_Message *error = MD_MakeNodeError(child_parse.node, MD_MessageKind_Warning, MD_S8Lit("Unnamed set children of implicitly-delimited sets are not legal."));
+                    _MD_PushParseError(ctx, &result.errors, error);
+                }
+                
+                if(ctx->event_callback == 0)
+                {
+                    MD_PushChild(parent, child_parse.node);
+                }
+                parsed_child_count += 1;
+                last_child_end = child_parse.node->end_offset;
+            }
+            
+            //- rjf: check trailing separator
+            MD_NodeFlags trailing_separator_flags = 0;
+            if(!close_with_separator)
+            {
+                off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+                MD_Token trailing_separator = _MD_ParseToken(ctx, string, off, 0);
+                if (trailing_separator.kind == MD_TokenKind_Reserved){
+                    MD_u8 c = trailing_separator.string.str[0];
+                    if(c == ',')
+                    {
+                        trailing_separator_flags |= MD_NodeFlag_IsBeforeComma;
+                        off += trailing_separator.raw_string.size;
+                    }
+                    else if(c == ';')
+                    {
+                        trailing_separator_flags |= MD_NodeFlag_IsBeforeSemicolon;
+                        off += trailing_separator.raw_string.size;
+                    }
+                }
+            }
+            
             //- rjf: fill child flags
             child_parse.node->flags |= next_child_flags | trailing_separator_flags;
             
-            //- rjf: setup next_child_flags
-            next_child_flags = MD_NodeFlag_AfterFromBefore(trailing_separator_flags);
+            //- rjf: setup next_child_flags
+            next_child_flags = MD_NodeFlag_AfterFromBefore(trailing_separator_flags);
+        }
+    }
+    end_parse:;
+    ctx->depth -= 1;
+    
+    //- extend the parent over its children, and its closer if it has one
+    if(set_opener != 0 && got_closer)
+    {
+        parent->end_offset = off;
+    }
+    else if(last_child_end > parent->end_offset)
+    {
+        parent->end_offset = last_child_end;
+    }
+    
+    //- rjf: push missing closer error, if we have one
+    if(set_opener != 0 && got_closer == 0 && !ctx->stopped &&
+       _MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_CatastrophicError,
+                              string, initial_token.raw_string.str - string.str))
+    {
+        // NOTE(rjf): @error We didn't get a closer for the set
+        MD_String8 error_string = ((ctx->options.flags & MD_ParseFlag_TerseErrors) ?
+                                   MD_S8Lit("Unbalanced delimiter") :
+                                   MD_S8Fmt("Unbalanced \"%c\"", set_opener));
+        MD_Message *error = MD_MakeTokenError(string, initial_token, MD_MessageKind_CatastrophicError,
+                                              error_string);
+        _MD_PushParseError(ctx, &result.errors, error);
+    }
+    
+    //- rjf: push empty implicit set error,
+    if(close_with_separator && parsed_child_count == 0 && !ctx->stopped &&
+       _MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_Error,
+                              string, initial_token.raw_string.str - string.str))
+    {
+        // NOTE(rjf): @error No empty implicitly-delimited sets
+        MD_Message *error = MD_MakeTokenError(string, initial_token, MD_MessageKind_Error,
+                                              MD_S8Lit("Empty implicitly-delimited node list"));
+        _MD_PushParseError(ctx, &result.errors, error);
+    }
+    
+    if(send_set_events)
+    {
+        _MD_SendNodeEvent(ctx, MD_ParseEventKind_EndSet, ctx->depth - 1, parent);
+        ctx->set_depth -= 1;
+    }
+    
+    //- rjf: fill result info
+    result.node = parent->first_child;
+    result.last_node = parent->last_child;
+    result.string_advance= off - offset;
+    
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseNodeSet(MD_String8 string, MD_u64 offset, MD_Node *parent, MD_ParseSetRule rule)
+{
+    MD_ParseCtx ctx = _MD_MakeParseCtx(0);
+    return _MD_ParseNodeSet(&ctx, string, offset, parent, rule);
+}
+
+// TODO(rjf): Inline this in the only place it is called
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult
+_MD_ParseTagList(MD_ParseCtx *ctx, MD_String8 string, MD_u64 offset)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    MD_u64 off = offset;
+    MD_u64 tag_count = 0;
+    
+    for(;off < string.size;)
+    {
+        if(_MD_CheckParseLimits(ctx, &result.errors, string, off))
+        {
+            break;
+        }
+        
+        //- rjf: parse @ symbol, signifying start of tag
+        off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+        MD_Token next_token = _MD_ParseToken(ctx, string, off, 0);
+        if(next_token.kind != MD_TokenKind_Reserved ||
+           next_token.string.str[0] != '@')
+        {
+            break;
+        }
+        off += next_token.raw_string.size;
+        
+        //- rjf: parse string of tag node
+        MD_Token name = _MD_ParseToken(ctx, string, off, ctx->lex_flags);
+        MD_u64 name_off = off;
+        if((name.kind & MD_TokenGroup_Label) == 0)
+        {
+            // NOTE(rjf): @error Improper token for tag string
+            if(_MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_Error, string, off))
+            {
+                MD_String8 error_string = ((ctx->options.flags & MD_ParseFlag_TerseErrors) ?
+                                           MD_S8Lit("Improper tag label") :
+                                           MD_S8Fmt("\"%.*s\" is not a proper tag label",
+                                                    MD_S8VArg(name.raw_string)));
+                MD_Message *error = MD_MakeTokenError(string, name, MD_MessageKind_Error, error_string);
+                _MD_PushParseError(ctx, &result.errors, error);
+            }
+            break;
+        }
+        off += name.raw_string.size;
+        MD_Token open_paren = _MD_ParseToken(ctx, string, off, 0);
+        MD_b32 has_args = (open_paren.kind == MD_TokenKind_Reserved && open_paren.string.str[0] == '(');
+        
+        //- skip unwanted tags; unclosed arguments are still parsed, to report them
+        MD_b32 skip_tag = !!(ctx->options.flags & MD_ParseFlag_SkipTags);
+        if(skip_tag)
+        {
+            MD_u64 closer_off = 0;
+            if(!has_args)
+            {
+                continue;
+            }
+            else if(_MD_FindSetCloser(ctx, string, off, &closer_off))
+            {
+                off = closer_off + 1;
+                continue;
+            }
+        }
+        
+        //- rjf: build tag
+        MD_Node *tag = _MD_ParseMakeNode(ctx, MD_NodeKind_Tag, name.string, name.raw_string, name_off);
+        if(!skip_tag)
+        {
+            _MD_SendNodeEvent(ctx, MD_ParseEventKind_Tag, ctx->depth - 1, tag);
+        }
+        
+        //- rjf: parse tag arguments
+        MD_ParseResult args_parse = MD_ParseResultZero();
+        if(has_args)
+        {
+            ctx->tag_arg_depth += 1;
+            args_parse = _MD_ParseNodeSet(ctx, string, off, tag, MD_ParseSetRule_EndOnDelimiter);
+            ctx->tag_arg_depth -= 1;
+            MD_MessageListConcat(&result.errors, &args_parse.errors);
+        }
+        off += args_parse.string_advance;
+        
+        //- rjf: push tag to result
+        if(ctx->event_callback == 0 && !skip_tag)
+        {
+            MD_NodeDblPushBack(result.node, result.last_node, tag);
+            tag->index = tag_count;
+            tag_count += 1;
+        }
+    }
+    
+    //- rjf: fill result
+    result.string_advance= off - offset;
+    
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult
+_MD_ParseOneNode(MD_ParseCtx *ctx, MD_String8 string, MD_u64 offset)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    MD_u64 off = offset;
+    
+    //- rjf: parse pre-comment
+    MD_String8 prev_comment = MD_ZERO_STRUCT;
+    if(ctx->options.flags & MD_ParseFlag_SkipComments)
+    {
+        off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+    }
+    else
+    {
+        MD_Token comment_token = MD_ZERO_STRUCT;
+        for(;off < string.size;)
+        {
+            MD_Token token = _MD_ParseToken(ctx, string, off, 0);
+            if(token.kind == MD_TokenKind_Comment)
+            {
+                off += token.raw_string.size;
+                comment_token = token;
+            }
+            else if(token.kind == MD_TokenKind_Newline)
+            {
+                off += token.raw_string.size;
+                MD_Token next_token = _MD_ParseToken(ctx, string, off, 0);
+                if(next_token.kind == MD_TokenKind_Comment)
+                {
+                    // NOTE(mal): If more than one comment, use the last comment
+                    comment_token = next_token;
+                }
+                else if(next_token.kind == MD_TokenKind_Newline)
+                {
+                    MD_MemoryZero(&comment_token, sizeof(comment_token));
+                }
+            }
+            else if((token.kind & MD_TokenGroup_Whitespace) != 0)
+            {
+                off += token.raw_string.size;
+            }
+            else
+            {
+                break;
+            }
+            prev_comment = comment_token.string;
+        }
+        if(prev_comment.size != 0)
+        {
+            _MD_SendParseEvent(ctx, MD_ParseEventKind_Comment, ctx->depth - 1, MD_NilNode(), prev_comment,
+                               comment_token.raw_string.str - string.str, 0);
+        }
+    }
+    
+    //- rjf: parse tag list
+    MD_ParseResult tags_parse = _MD_ParseTagList(ctx, string, off);
+    off += tags_parse.string_advance;
+    MD_MessageListConcat(&result.errors, &tags_parse.errors);
+    
+    //- rjf: parse node
+    MD_Node *parsed_node = MD_NilNode();
+    MD_ParseResult children_parse = MD_ParseResultZero();
+    retry:;
+    if(_MD_CheckParseLimits(ctx, &result.errors, string, off))
+    {
+        goto end_parse;
+    }
+    {
+        //- rjf: try to parse an unnamed set
+        off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+        MD_Token unnamed_set_opener = _MD_ParseToken(ctx, string, off, 0);
+        if(unnamed_set_opener.kind == MD_TokenKind_Reserved)
+        {
+            MD_u8 c = unnamed_set_opener.string.str[0];
+            if (c == '(' || c == '{' || c == '[')
+            {
+                parsed_node = _MD_ParseMakeNode(ctx, MD_NodeKind_Main, MD_S8Lit(""), MD_S8Lit(""),
+                                                unnamed_set_opener.raw_string.str - string.str);
+                _MD_SendNodeEvent(ctx, MD_ParseEventKind_BeginNode, ctx->depth - 1, parsed_node);
+                _MD_IndexParsedNode(ctx, parsed_node, tags_parse.node);
+                children_parse = _MD_ParseNodeSet(ctx, string, off, parsed_node, MD_ParseSetRule_EndOnDelimiter);
+                off += children_parse.string_advance;
+                MD_MessageListConcat(&result.errors, &children_parse.errors);
+            }
+            else if (c == ')' || c == '}' || c == ']')
+            {
+                // NOTE(rjf): @error Unexpected set closing symbol
+                if(_MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_CatastrophicError, string, off))
+                {
+                    MD_String8 error_string = ((ctx->options.flags & MD_ParseFlag_TerseErrors) ?
+                                               MD_S8Lit("Unbalanced delimiter") :
+                                               MD_S8Fmt("Unbalanced \"%c\"", c));
+                    MD_Message *error = MD_MakeTokenError(string, unnamed_set_opener,
+                                                          MD_MessageKind_CatastrophicError, error_string);
+                    _MD_PushParseError(ctx, &result.errors, error);
+                }
+                off += unnamed_set_opener.raw_string.size;
+            }
+            else
+            {
+                // NOTE(rjf): @error Unexpected reserved symbol
+                if(_MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_Error, string, off))
+                {
+                    MD_String8 error_string = ((ctx->options.flags & MD_ParseFlag_TerseErrors) ?
+                                               MD_S8Lit("Unexpected reserved symbol") :
+                                               MD_S8Fmt("Unexpected reserved symbol \"%c\"", c));
+                    MD_Message *error = MD_MakeTokenError(string, unnamed_set_opener,
+                                                          MD_MessageKind_Error, error_string);
+                    _MD_PushParseError(ctx, &result.errors, error);
+                }
+                off += unnamed_set_opener.raw_string.size;
+            }
+            goto end_parse;
+            
+        }
+        
+        //- rjf: try to parse regular node, with/without children
+        off += _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Irregular);
+        MD_Token label_name = _MD_ParseToken(ctx, string, off, ctx->lex_flags);
+        if((label_name.kind & MD_TokenGroup_Label) != 0)
+        {
+            off += label_name.raw_string.size;
+            parsed_node = _MD_ParseMakeNode(ctx, MD_NodeKind_Main, label_name.string, label_name.raw_string,
+                                            label_name.raw_string.str - string.str);
+            parsed_node->flags |= label_name.node_flags;
+            _MD_SendNodeEvent(ctx, MD_ParseEventKind_BeginNode, ctx->depth - 1, parsed_node);
+            _MD_IndexParsedNode(ctx, parsed_node, tags_parse.node);
+            
+            //- rjf: try to parse children for this node
+            MD_u64 colon_check_off = off;
+            colon_check_off += _MD_ParseAdvanceFromSkips(ctx, string, colon_check_off, MD_TokenGroup_Irregular);
+            MD_Token colon = _MD_ParseToken(ctx, string, colon_check_off, 0);
+            if(colon.kind == MD_TokenKind_Reserved &&
+               colon.string.str[0] == ':')
+            {
+                colon_check_off += colon.raw_string.size;
+                off = colon_check_off;
+                
+                children_parse = _MD_ParseNodeSet(ctx, string, off, parsed_node, MD_ParseSetRule_EndOnDelimiter);
+                off += children_parse.string_advance;
+                MD_MessageListConcat(&result.errors, &children_parse.errors);
+            }
+            goto end_parse;
+        }
+        
+        //- collect bad tokens; runs of one kind, separated only by whitespace,
+        // are reported as one error, whose marker's string covers the run
+        MD_Token bad_token = _MD_ParseToken(ctx, string, off, ctx->lex_flags);
+        if(bad_token.kind & MD_TokenGroup_Error)
+        {
+            MD_u64 bad_off = off;
+            MD_u64 bad_token_count = 0;
+            for(MD_Token run_token = bad_token;;)
+            {
+                off += run_token.raw_string.size;
+                bad_token_count += 1;
+                MD_u64 next_off = off + _MD_ParseAdvanceFromSkips(ctx, string, off, MD_TokenGroup_Whitespace);
+                run_token = _MD_ParseToken(ctx, string, next_off, ctx->lex_flags);
+                if(run_token.kind != bad_token.kind)
+                {
+                    break;
+                }
+                off = next_off;
+            }
+            MD_String8 bad_string = MD_S8Substring(string, bad_off, off);
+            MD_b32 terse = !!(ctx->options.flags & MD_ParseFlag_TerseErrors);
+            
+            if(_MD_ParseErrorIsWanted(ctx, &result.errors, MD_MessageKind_Error, string, bad_off))
+            {
+                MD_String8 error_string = MD_ZERO_STRUCT;
+                switch (bad_token.kind){
+                    default: break;
+                    
+                    case MD_TokenKind_BadCharacter:
+                    {
+                        // NOTE(rjf): @error Bad character
+                        error_string = MD_S8Lit("Non-ASCII character");
+                        if(!terse)
+                        {
+                            MD_String8List bytes = {0};
+                            MD_u64 bad_byte_count = 0;
+                            for(MD_u64 i_byte = 0; i_byte < bad_string.size; i_byte += 1)
+                            {
+                                MD_u8 b = bad_string.str[i_byte];
+                                if(!MD_CharIsSpace(b) && b != '\n')
+                                {
+                                    if(bad_byte_count < 8)
+                                    {
+                                        MD_S8ListPush(&bytes, MD_CStyleHexStringFromU64(b, 1));
+                                    }
+                                    bad_byte_count += 1;
+                                }
+                            }
+                            
+                            MD_StringJoin join = MD_ZERO_STRUCT;
+                            join.mid = MD_S8Lit(" ");
+                            MD_String8 byte_string = MD_S8ListJoin(bytes, &join);
+                            ctx->byte_count += (bytes.node_count*sizeof(MD_String8Node) +
+                                                bytes.total_size + byte_string.size + 1);
+                            if(bad_token_count == 1)
+                            {
+                                error_string = MD_S8Fmt("Non-ASCII character \"%.*s\"", MD_S8VArg(byte_string));
+                            }
+                            else if(bad_byte_count <= bytes.node_count)
+                            {
+                                error_string = MD_S8Fmt("Non-ASCII characters \"%.*s\"", MD_S8VArg(byte_string));
+                            }
+                            else
+                            {
+                                error_string = MD_S8Fmt("%llu non-ASCII characters, starting with \"%.*s\"",
+                                                        bad_token_count, MD_S8VArg(byte_string));
+                            }
+                        }
+                    }break;
+                    
+                    case MD_TokenKind_BrokenComment:
+                    {
+                        // NOTE(rjf): @error Broken Comments
+                        error_string = MD_S8Lit("Unterminated comment");
+                    }break;
+                    
+                    case MD_TokenKind_BrokenStringLiteral:
+                    {
+                        // NOTE(rjf): @error Broken String Literals
+                        error_string = MD_S8Lit("Unterminated string literal");
+                        if(!terse && bad_token_count > 1)
+                        {
+                            error_string = MD_S8Fmt("%llu unterminated string literals", bad_token_count);
+                        }
+                    }break;
+                }
+                MD_Message *error = MD_MakeTokenError(string, bad_token, MD_MessageKind_Error, error_string);
+                error->node->string = bad_string;
+                _MD_PushParseError(ctx, &result.errors, error);
+            }
+            goto retry;
+        }
+    }
+    
+    end_parse:;
+    
+    //- rjf: parse comments after nodes.
+    MD_String8 next_comment = MD_ZERO_STRUCT;
+    {
+        MD_Token comment_token = MD_ZERO_STRUCT;
+        for(;;)
+        {
+            MD_Token token = _MD_ParseToken(ctx, string, off, 0);
+            if(token.kind == MD_TokenKind_Comment)
+            {
+                comment_token = token;
+                off += token.raw_string.size;
+                break;
+            }
+            
+            else if(token.kind == MD_TokenKind_Newline)
+            {
+                break;
+            }
+            else if((token.kind & MD_TokenGroup_Whitespace) != 0)
+            {
+                off += token.raw_string.size;
+            }
+            else
+            {
+                break;
+            }
+        }
+        if(!(ctx->options.flags & MD_ParseFlag_SkipComments))
+        {
+            next_comment = comment_token.string;
+        }
+        if(next_comment.size != 0)
+        {
+            _MD_SendParseEvent(ctx, MD_ParseEventKind_Comment, ctx->depth - 1, MD_NilNode(), next_comment,
+                               comment_token.raw_string.str - string.str, 0);
+        }
+    }
+    
+    //- rjf: fill result
+    parsed_node->prev_comment = prev_comment;
+    parsed_node->next_comment = next_comment;
+    result.node = parsed_node;
+    if(!MD_NodeIsNil(result.node) && ctx->event_callback == 0)
+    {
+        result.node->first_tag = tags_parse.node;
+        result.node->last_tag = tags_parse.last_node;
+        if(!MD_NodeIsNil(tags_parse.last_node))
+        {
+            result.node->tag_count = tags_parse.last_node->index + 1;
+        }
+        for(MD_EachNode(tag, tags_parse.node))
+        {
+            tag->parent = result.node;
+            result.node->tag_bloom |= _MD_TagBloomFromString(tag->string);
+        }
+    }
+    result.last_node = parsed_node;
+    result.string_advance= off - offset;
+    
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseOneNode(MD_String8 string, MD_u64 offset)
+{
+    MD_ParseCtx ctx = _MD_MakeParseCtx(0);
+    return _MD_ParseOneNode(&ctx, string, offset);
+}
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_AttachErrorsToRoot(MD_MessageList *errors, MD_Node *root)
+{
+    for(MD_Message *error = errors->first; error != 0; error = error->next)
+    {
+        if(MD_NodeIsNil(error->node->parent))
+        {
+            error->node->parent = root;
+        }
+    }
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseWholeString(MD_String8 filename, MD_String8 contents)
+{
+    return MD_ParseWholeStringWithOptions(filename, contents, 0);
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseWholeStringWithOptions(MD_String8 filename, MD_String8 contents, MD_ParseOptions *options)
+{
+    MD_ParseCtx ctx = _MD_MakeParseCtx(options);
+    MD_Node *root = MD_MakeNode(MD_NodeKind_File, filename, contents, 0);
+    if(ctx.options.index != 0)
+    {
+        _MD_IndexRankFromRoot(ctx.options.index, root);
+    }
+    if(_MD_ParseShouldReadIndex(contents))
+    {
+        _MD_BuildParseIndex(&ctx, contents);
+        ctx.read_index = 1;
+    }
+    MD_ParseResult result = _MD_ParseNodeSet(&ctx, contents, 0, root, MD_ParseSetRule_Global);
+    result.node = result.last_node = root;
+    _MD_AttachErrorsToRoot(&result.errors, root);
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseWholeFile(MD_String8 filename)
+{
+    return MD_ParseWholeFileWithOptions(filename, 0);
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult _MD_ParseWholeFileWithCache(MD_String8 filename, MD_String8 contents, MD_ParseOptions *options);
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseWholeFileWithOptions(MD_String8 filename, MD_ParseOptions *options)
+{
+    MD_String8 file_contents = MD_LoadEntireFile(filename);
+    MD_ParseResult parse = MD_ZERO_STRUCT;
+    if(options != 0 && options->cache_dir.size != 0 && file_contents.str != 0)
+    {
+        parse = _MD_ParseWholeFileWithCache(filename, file_contents, options);
+    }
+    else
+    {
+        parse = MD_ParseWholeStringWithOptions(filename, file_contents, options);
+    }
+    if(file_contents.str == 0)
+    {
+        // NOTE(rjf): @error File failing to load
+        MD_Message *error = MD_MakeNodeError(parse.node, MD_MessageKind_CatastrophicError,
+                                             MD_S8Fmt("Could not read file \"%.*s\"", MD_S8VArg(filename)));
+        MD_MessageListPush(&parse.errors, error);
+    }
+    return parse;
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ExpandNode(MD_Node *node)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    result.node = result.last_node = node;
+    if(node->unexpanded != 0)
+    {
+        MD_UnexpandedSet *unexpanded = node->unexpanded;
+        node->unexpanded = 0;
+        MD_ParseCtx ctx = _MD_MakeParseCtx(&unexpanded->options);
+        ctx.expanding_node = node;
+        ctx.index = unexpanded->index;
+        ctx.read_index = unexpanded->read_index;
+        MD_ParseResult children_parse = _MD_ParseNodeSet(&ctx, unexpanded->contents, unexpanded->offset,
+                                                         node, MD_ParseSetRule_EndOnDelimiter);
+        result.errors = children_parse.errors;
+        
+        // NOTE: Expanded children land in the middle of the document, so
+        // they are indexed once they are linked.
+        if(unexpanded->options.index != 0)
+        {
+            for(MD_EachNode(child, node->first_child))
+            {
+                MD_IndexAddSubtree(unexpanded->options.index, child);
+            }
+        }
+        _MD_AttachErrorsToRoot(&result.errors, MD_RootFromNode(node));
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_MessageKind
+MD_ParseEventsFromString(MD_String8 contents, MD_ParseOptions *options,
+                         MD_ParseEventCallback *callback, void *user_data)
+{
+    MD_Node event_nodes[64];
+    MD_Node root;
+    _MD_InitNode(&root, MD_NodeKind_File, MD_S8Lit(""), contents, 0);
+    MD_ParseCtx ctx = _MD_MakeParseCtx(options);
+    ctx.event_callback = callback;
+    ctx.event_user_data = user_data;
+    ctx.event_nodes = event_nodes;
+    ctx.event_node_count = MD_ArrayCount(event_nodes);
+    MD_ParseResult parse = _MD_ParseNodeSet(&ctx, contents, 0, &root, MD_ParseSetRule_Global);
+    return parse.errors.max_message_kind;
+}
+
+//~ Structural Index
+
+// NOTE: Stage one of indexing finds every byte that might matter to the
+// structure: reserved symbols, newlines, quotes, slashes, and the bytes that
+// end or escape strings and comments, plus a few harmless false positives.
+// On x64 this is done with SSE2, 64 bytes at a time; elsewhere it is done a
+// byte at a time. Stage two is a small state machine that visits only those
+// bytes, tracking strings and comments with the same rules as the lexer, and
+// matching brackets with the same rules as the parser: '}' only closes '{',
+// either of ')' and ']' closes either of '(' and '[', and closers that don't
+// match are skipped. Each entry records the extent and kind of its token, so
+// that the parser can read tokens from the index; see _MD_ParseToken.
+
+typedef enum _MD_StructuralState
+{
+    _MD_StructuralState_Normal,
+    _MD_StructuralState_String,
+    _MD_StructuralState_LineComment,
+    _MD_StructuralState_BlockComment,
+}
+_MD_StructuralState;
+
+typedef struct _MD_StructuralIndexBuilder _MD_StructuralIndexBuilder;
+struct _MD_StructuralIndexBuilder
+{
+    MD_StructuralIndex index;
+    MD_u64 cap;
+    MD_u64 *openers;
+    MD_u64 opener_count;
+    MD_u64 opener_cap;
+    
+    _MD_StructuralState state;
+    MD_u8 string_delimiter;
+    MD_u64 comment_depth;
+    MD_u64 skip_until;
+    MD_u64 open_entry;
+    
+    // NOTE: Bytes allocated, and the most that may be; zero means no limit.
+    MD_u64 byte_count;
+    MD_u64 max_byte_count;
+    MD_b32 failed;
+};
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_CharIsStructuralCandidate(MD_u8 c)
+{
+    return ((c >= 0x22 && c <= 0x2F) || (c >= 0x0A && c <= 0x0D) ||
+            c == ':' || c == ';' || c == '@' || c == '`' ||
+            ((c|0x20) >= '{' && (c|0x20) <= '}'));
+}
+
+// NOTE: Returns whether size more bytes fit in the builder's budget, and
+// charges them if so; once they do not, the build has failed.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_StructuralIndexReserve(_MD_StructuralIndexBuilder *b, MD_u64 size)
+{
+    if(b->max_byte_count != 0 && b->byte_count + size > b->max_byte_count)
+    {
+        b->failed = 1;
+    }
+    if(!b->failed)
+    {
+        b->byte_count += size;
+    }
+    return !b->failed;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64 *
+_MD_GrowU64Array(MD_u64 *array, MD_u64 count, MD_u64 new_cap)
+{
+    MD_u64 *new_array = MD_PushArray(MD_u64, new_cap);
+    MD_MemoryCopy(new_array, array, sizeof(MD_u64)*count);
+    return new_array;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_StructuralIndexGrow(_MD_StructuralIndexBuilder *b, MD_u64 new_cap)
+{
+    MD_b32 result = _MD_StructuralIndexReserve(b, (3*sizeof(MD_u64) + sizeof(MD_TokenKind))*new_cap);
+    if(result)
+    {
+        MD_StructuralIndex *index = &b->index;
+        MD_TokenKind *kinds = MD_PushArray(MD_TokenKind, new_cap);
+        MD_MemoryCopy(kinds, index->kinds, sizeof(MD_TokenKind)*index->count);
+        index->offsets = _MD_GrowU64Array(index->offsets, index->count, new_cap);
+        index->partners = _MD_GrowU64Array(index->partners, index->count, new_cap);
+        index->ends = _MD_GrowU64Array(index->ends, index->count, new_cap);
+        index->kinds = kinds;
+        b->cap = new_cap;
+    }
+    return result;
+}
+
+// NOTE: Entries are pushed as one-byte tokens; strings and comments have
+// their end, and their kind once they are closed, filled in as they are
+// scanned.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_StructuralIndexPush(_MD_StructuralIndexBuilder *b, MD_String8 string, MD_u64 off, MD_TokenKind kind)
+{
+    //- push entry
+    MD_StructuralIndex *index = &b->index;
+    if(index->count == b->cap && !_MD_StructuralIndexGrow(b, b->cap ? b->cap*2 : 256))
+    {
+        return;
+    }
+    MD_u64 entry = index->count;
+    index->offsets[entry] = off;
+    index->partners[entry] = entry;
+    index->ends[entry] = off + 1;
+    index->kinds[entry] = kind;
+    index->count += 1;
+    b->open_entry = entry;
+    
+    //- match brackets
+    MD_u8 c = string.str[off];
+    if(c == '{' || c == '(' || c == '[')
+    {
+        if(b->opener_count == b->opener_cap)
+        {
+            if(!_MD_StructuralIndexReserve(b, sizeof(MD_u64)*(b->opener_cap ? b->opener_cap*2 : 64)))
+            {
+                return;
+            }
+            b->opener_cap = b->opener_cap ? b->opener_cap*2 : 64;
+            b->openers = _MD_GrowU64Array(b->openers, b->opener_count, b->opener_cap);
+        }
+        b->openers[b->opener_count] = entry;
+        b->opener_count += 1;
+    }
+    else if((c == '}' || c == ')' || c == ']') && b->opener_count > 0)
+    {
+        MD_u64 opener = b->openers[b->opener_count - 1];
+        MD_b32 opener_is_brace = (string.str[index->offsets[opener]] == '{');
+        if(opener_is_brace == (c == '}'))
+        {
+            index->partners[opener] = entry;
+            index->partners[entry] = opener;
+            b->opener_count -= 1;
+        }
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_FindFirstOf3(MD_String8 string, MD_u64 off, MD_u8 a, MD_u8 b, MD_u8 c)
+{
+#if MD_ARCH_X64
+    __m128i va = _mm_set1_epi8((char)a);
+    __m128i vb = _mm_set1_epi8((char)b);
+    __m128i vc = _mm_set1_epi8((char)c);
+    for(; off + 16 <= string.size; off += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((__m128i *)(string.str + off));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, va), _mm_cmpeq_epi8(bytes, vb)),
+                                    _mm_cmpeq_epi8(bytes, vc));
+        MD_u32 mask = (MD_u32)_mm_movemask_epi8(hits);
+        if(mask != 0)
+        {
+            return off + _MD_CountTrailingZeros64(mask);
+        }
+    }
+#endif
+    for(; off < string.size; off += 1)
+    {
+        MD_u8 x = string.str[off];
+        if(x == a || x == b || x == c)
+        {
+            break;
+        }
+    }
+    return off;
+}
+
+// NOTE: Inside strings and comments, skip_until is always moved to the
+// next byte that could end or escape them, so that the bytes in between are
+// never visited.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_StructuralIndexVisit(_MD_StructuralIndexBuilder *b, MD_String8 string, MD_u64 off)
+{
+    if(off < b->skip_until)
+    {
+        return;
+    }
+    MD_u8 c = string.str[off];
+    MD_u8 next = (off + 1 < string.size) ? string.str[off + 1] : 0;
+    MD_u8 d = b->string_delimiter;
+    switch(b->state)
+    {
+        case _MD_StructuralState_String:
+        {
+            if(c == d)
+            {
+                b->state = _MD_StructuralState_Normal;
+                b->index.ends[b->open_entry] = off + 1;
+                b->index.kinds[b->open_entry] = MD_TokenKind_StringLiteral;
+            }
+            else if(c == '\\')
+            {
+                MD_u64 resume_off = (next == d || next == '\\') ? off + 2 : off + 1;
+                b->skip_until = _MD_FindFirstOf3(string, resume_off, d, '\\', '\n');
+            }
+            else if(c == '\n')
+            {
+                // NOTE: Unterminated; the newline is lexed on its own.
+                b->state = _MD_StructuralState_Normal;
+                b->index.ends[b->open_entry] = off;
+                _MD_StructuralIndexPush(b, string, off, MD_TokenKind_Newline);
+            }
+        }break;
+        
+        case _MD_StructuralState_LineComment:
+        {
+            b->state = _MD_StructuralState_Normal;
+            b->index.ends[b->open_entry] = off;
+            if(c == '\n')
+            {
+                _MD_StructuralIndexPush(b, string, off, MD_TokenKind_Newline);
+            }
+        }break;
+        
+        case _MD_StructuralState_BlockComment:
+        {
+            MD_u64 resume_off = off + 1;
+            if(c == '*' && next == '/')
+            {
+                b->comment_depth -= 1;
+                resume_off = off + 2;
+            }
+            else if(c == '/' && next == '*')
+            {
+                b->comment_depth += 1;
+                resume_off = off + 2;
+            }
+            if(b->comment_depth == 0)
+            {
+                b->state = _MD_StructuralState_Normal;
+                b->skip_until = resume_off;
+                b->index.ends[b->open_entry] = resume_off;
+                b->index.kinds[b->open_entry] = MD_TokenKind_Comment;
+            }
+            else
+            {
+                b->skip_until = _MD_FindFirstOf3(string, resume_off, '*', '/', '/');
+            }
+        }break;
+        
+        case _MD_StructuralState_Normal:
+        {
+            if(c == '"' || c == '\'' || c == '`')
+            {
+                _MD_StructuralIndexPush(b, string, off, MD_TokenKind_BrokenStringLiteral);
+                if(next == c && off + 2 < string.size && string.str[off + 2] == c)
+                {
+                    // NOTE: Triple-delimited strings are rare; let the lexer skip them.
+                    MD_Token token = MD_TokenFromString(MD_S8Skip(string, off));
+                    b->skip_until = off + token.raw_string.size;
+                    if(!b->failed)
+                    {
+                        b->index.ends[b->open_entry] = b->skip_until;
+                        b->index.kinds[b->open_entry] = token.kind;
+                    }
+                }
+                else
+                {
+                    b->state = _MD_StructuralState_String;
+                    b->string_delimiter = c;
+                    b->skip_until = _MD_FindFirstOf3(string, off + 1, c, '\\', '\n');
+                }
+            }
+            else if(c == '/' && next == '/')
+            {
+                _MD_StructuralIndexPush(b, string, off, MD_TokenKind_Comment);
+                b->state = _MD_StructuralState_LineComment;
+                b->skip_until = _MD_FindFirstOf3(string, off + 2, '\n', '\r', '\n');
+            }
+            else if(c == '/' && next == '*')
+            {
+                _MD_StructuralIndexPush(b, string, off, MD_TokenKind_BrokenComment);
+                b->state = _MD_StructuralState_BlockComment;
+                b->comment_depth = 1;
+                b->skip_until = _MD_FindFirstOf3(string, off + 2, '*', '/', '/');
+            }
+            else if(c == '\n' || (MD_CharIsReservedSymbol(c) && c != '\\'))
+            {
+                // NOTE: '\\' is reserved, but lexes as an unreserved symbol.
+                _MD_StructuralIndexPush(b, string, off, c == '\n' ? MD_TokenKind_Newline : MD_TokenKind_Reserved);
+            }
+        }break;
+    }
+}
+
+#if MD_ARCH_X64
+// NOTE: Must agree with _MD_CharIsStructuralCandidate.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_StructuralCandidateMask64(MD_u8 *bytes)
+{
+    MD_u64 mask = 0;
+    for(int block_idx = 0; block_idx < 4; block_idx += 1)
+    {
+        __m128i block = _mm_loadu_si128((__m128i *)(bytes + block_idx*16));
+        __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+        __m128i hits = _MD_BytesInRange16(block, 0x22, 0x2F);
+        hits = _mm_or_si128(hits, _MD_BytesInRange16(block, 0x0A, 0x0D));
+        hits = _mm_or_si128(hits, _MD_BytesInRange16(block, ':', ';'));
+        hits = _mm_or_si128(hits, _MD_BytesInRange16(folded, '{', '}'));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(folded, _mm_set1_epi8('`')));
+        mask |= ((MD_u64)(MD_u32)_mm_movemask_epi8(hits)) << (block_idx*16);
+    }
+    return mask;
+}
+#endif
+
+// NOTE: Stops and returns 0 once the arrays it allocates would take more
+// than max_byte_count bytes, where zero means no limit. Every byte allocated
+// is added to *byte_count, whether or not the build succeeds.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_BuildStructuralIndex(MD_String8 string, MD_u64 max_byte_count, MD_StructuralIndex *index_out,
+                         MD_u64 *byte_count)
+{
+    _MD_StructuralIndexBuilder b = MD_ZERO_STRUCT;
+    b.max_byte_count = max_byte_count;
+    MD_u64 off = 0;
+    
+    //- reserve for a typical density, to avoid most regrowth
+    _MD_StructuralIndexGrow(&b, string.size/8 + 256);
+    
+    //- wide scan
+#if MD_ARCH_X64
+    for(; off + 64 <= string.size && !b.failed;)
+    {
+        MD_u64 mask = _MD_StructuralCandidateMask64(string.str + off);
+        for(;;)
+        {
+            if(b.skip_until > off)
+            {
+                MD_u64 skip_n = b.skip_until - off;
+                mask &= (skip_n >= 64) ? 0 : (~0ull << skip_n);
+            }
+            if(mask == 0 || b.failed)
+            {
+                break;
+            }
+            _MD_StructuralIndexVisit(&b, string, off + _MD_CountTrailingZeros64(mask));
+            mask &= mask - 1;
+        }
+        off += 64;
+        if(b.skip_until > off)
+        {
+            off = b.skip_until;
+        }
+    }
+#endif
+    
+    //- narrow scan
+    for(; off < string.size && !b.failed; off += 1)
+    {
+        if(_MD_CharIsStructuralCandidate(string.str[off]))
+        {
+            _MD_StructuralIndexVisit(&b, string, off);
+        }
+    }
+    
+    //- a string or comment still open runs to the end
+    if(b.state != _MD_StructuralState_Normal && !b.failed)
+    {
+        b.index.ends[b.open_entry] = string.size;
+    }
+    
+    *index_out = b.index;
+    *byte_count += b.byte_count;
+    return !b.failed;
+}
+
+MD_FUNCTION_IMPL MD_StructuralIndex
+MD_StructuralIndexFromString(MD_String8 string)
+{
+    MD_StructuralIndex index = MD_ZERO_STRUCT;
+    MD_u64 byte_count = 0;
+    _MD_BuildStructuralIndex(string, 0, &index, &byte_count);
+    return index;
+}
+
+MD_FUNCTION_IMPL MD_u64
+MD_StructuralIndexEntryFromOffset(MD_StructuralIndex *index, MD_u64 offset)
+{
+    MD_u64 min = 0;
+    MD_u64 max = index->count;
+    for(; min < max;)
+    {
+        MD_u64 mid = min + (max - min)/2;
+        if(index->offsets[mid] < offset)
+        {
+            min = mid + 1;
+        }
+        else
+        {
+            max = mid;
+        }
+    }
+    return min;
+}
+
+// NOTE: Stage two of parsing; builds the token the lexer would produce at
+// an entry's offset without scanning its bytes again.
+MD_PRIVATE_FUNCTION_IMPL MD_Token
+_MD_TokenFromStructuralEntry(MD_StructuralIndex *index, MD_String8 string, MD_u64 entry)
+{
+    MD_Token token = MD_ZERO_STRUCT;
+    MD_u64 off = index->offsets[entry];
+    MD_u8 *first = string.str + off;
+    MD_u64 skip_n = 0;
+    MD_u64 chop_n = 0;
+    token.kind = index->kinds[entry];
+    switch(token.kind)
+    {
+        default: break;
+        
+        case MD_TokenKind_Comment:
+        case MD_TokenKind_BrokenComment:
+        {
+            skip_n = 2;
+            if(token.kind == MD_TokenKind_Comment && first[1] == '*')
+            {
+                chop_n = 2;
+            }
+        }break;
+        
+        case MD_TokenKind_StringLiteral:
+        case MD_TokenKind_BrokenStringLiteral:
+        {
+            MD_u8 d = first[0];
+            MD_b32 is_triplet = (off + 2 < string.size && first[1] == d && first[2] == d);
+            skip_n = is_triplet ? 3 : 1;
+            if(token.kind == MD_TokenKind_StringLiteral)
+            {
+                chop_n = skip_n;
+            }
+            token.node_flags = _MD_NodeFlagsFromStringDelimiter(d, is_triplet);
+        }break;
+    }
+    token.raw_string = MD_S8(first, index->ends[entry] - off);
+    token.string = MD_S8Substring(token.raw_string, skip_n, token.raw_string.size - chop_n);
+    return token;
+}
+
+//~ Location Conversions
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_BuildLineTable(MD_NodeAccel *accel, MD_String8 string)
+{
+    //- count lines
+    MD_u64 newline_count = 0;
+    MD_u64 off = 0;
+#if MD_ARCH_X64
+    for(; off + 16 <= string.size; off += 16)
+    {
+        __m128i block = _mm_loadu_si128((__m128i *)(string.str + off));
+        MD_u32 mask = (MD_u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        newline_count += _MD_PopCount32(mask);
+    }
+#endif
+    for(; off < string.size; off += 1)
+    {
+        newline_count += (string.str[off] == '\n');
+    }
+    
+    //- fill line starts
+    accel->line_count = newline_count + 1;
+    accel->line_offsets = MD_PushArray(MD_u64, accel->line_count);
+    MD_u64 line_idx = 1;
+    off = 0;
+#if MD_ARCH_X64
+    for(; off + 16 <= string.size; off += 16)
+    {
+        __m128i block = _mm_loadu_si128((__m128i *)(string.str + off));
+        MD_u32 mask = (MD_u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        for(; mask != 0; mask &= mask - 1)
+        {
+            accel->line_offsets[line_idx] = off + _MD_CountTrailingZeros64(mask) + 1;
+            line_idx += 1;
+        }
+    }
+#endif
+    for(; off < string.size; off += 1)
+    {
+        if(string.str[off] == '\n')
+        {
+            accel->line_offsets[line_idx] = off + 1;
+            line_idx += 1;
+        }
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_NodeAccel *
+_MD_LineTableFromRoot(MD_Node *root)
+{
+    MD_NodeAccel *accel = _MD_AccelFromNode(root);
+    if(accel->line_offsets == 0)
+    {
+        _MD_BuildLineTable(accel, root->raw_string);
+    }
+    return accel;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_LineIndexFromOffset(MD_NodeAccel *accel, MD_u64 offset)
+{
+    MD_u64 lo = 0;
+    MD_u64 hi = accel->line_count;
+    for(; hi - lo > 1;)
+    {
+        MD_u64 mid = lo + (hi - lo)/2;
+        if(accel->line_offsets[mid] <= offset)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_CodeLoc
+_MD_CodeLocFromLine(MD_Node *root, MD_NodeAccel *accel, MD_u64 line_idx, MD_u64 offset, MD_CodeLocFlags flags)
+{
+    MD_CodeLoc loc;
+    MD_u64 line_start = accel->line_offsets[line_idx];
+    MD_u64 column = offset - line_start;
+    if(flags & MD_CodeLocFlag_CodepointColumns)
+    {
+        // NOTE: count every byte that does not continue a UTF-8 sequence
+        column = 0;
+        for(MD_u64 i = line_start; i < offset; i += 1)
+        {
+            column += ((root->raw_string.str[i] & 0xC0) != 0x80);
+        }
+    }
+    loc.filename = root->string;
+    loc.line = (MD_u32)(line_idx + 1);
+    loc.column = (MD_u32)(column + 1);
+    return loc;
+}
+
+MD_FUNCTION_IMPL MD_CodeLoc
+MD_CodeLocFromFileOffset(MD_String8 filename, MD_u8 *base, MD_u64 offset)
+{
+    MD_CodeLoc loc;
+    loc.filename = filename;
+    loc.line = 1;
+    loc.column = 1;
+    if(base != 0)
+    {
+        MD_u8 *at = base + offset;
+        for(MD_u64 i = 0; base+i < at && base[i]; i += 1)
+        {
+            if(base[i] == '\n')
+            {
+                loc.line += 1;
+                loc.column = 1;
+            }
+            else
+            {
+                loc.column += 1;
+            }
+        }
+    }
+    return loc;
+}
+
+MD_FUNCTION_IMPL MD_CodeLoc
+MD_CodeLocFromNode(MD_Node *node)
+{
+    MD_Node *root = MD_RootFromNode(node);
+    MD_CodeLoc loc = MD_ZERO_STRUCT;
+    if(root->kind == MD_NodeKind_File)
+    {
+        loc = MD_CodeLocFromRootOffset(root, node->offset, 0);
+    }
+    else
+    {
+        // NOTE: Without a file root, the extent of the contents is unknown.
+        loc = MD_CodeLocFromFileOffset(root->string, root->raw_string.str, node->offset);
+    }
+    return loc;
+}
+
+MD_FUNCTION_IMPL MD_String8
+MD_SourceRangeFromNode(MD_Node *node)
+{
+    MD_String8 result = MD_ZERO_STRUCT;
+    MD_Node *root = MD_RootFromNode(node);
+    if(root->kind == MD_NodeKind_File)
+    {
+        //- start at the node's first tag, including its '@'
+        MD_u64 start = node->offset;
+        if(!MD_NodeIsNil(node->first_tag) && node->first_tag->offset > 0)
+        {
+            start = node->first_tag->offset - 1;
+        }
+        else if(node->kind == MD_NodeKind_Tag && start > 0)
+        {
+            start -= 1;
+        }
+        MD_u64 end = node->end_offset;
+        if(end > root->raw_string.size)
+        {
+            end = root->raw_string.size;
+        }
+        if(start <= end)
+        {
+            result = MD_S8Substring(root->raw_string, start, end);
+        }
+    }
+    return result;
+}
+
+// NOTE: The first call for a root builds a table of line starts, so every
+// call after it is a binary search.
+MD_FUNCTION_IMPL MD_CodeLoc
+MD_CodeLocFromRootOffset(MD_Node *root, MD_u64 offset, MD_CodeLocFlags flags)
+{
+    MD_NodeAccel *accel = _MD_LineTableFromRoot(root);
+    if(offset > root->raw_string.size)
+    {
+        offset = root->raw_string.size;
+    }
+    MD_u64 line_idx = _MD_LineIndexFromOffset(accel, offset);
+    return _MD_CodeLocFromLine(root, accel, line_idx, offset, flags);
+}
+
+// NOTE: Sorted offsets are found by walking forward through the lines;
+// an offset out of order falls back to a binary search.
+MD_FUNCTION_IMPL void
+MD_CodeLocsFromRootOffsets(MD_Node *root, MD_u64 *offsets, MD_u64 count,
+                           MD_CodeLocFlags flags, MD_CodeLoc *locs_out)
+{
+    MD_NodeAccel *accel = _MD_LineTableFromRoot(root);
+    MD_u64 line_idx = 0;
+    for(MD_u64 i = 0; i < count; i += 1)
+    {
+        MD_u64 offset = offsets[i];
+        if(offset > root->raw_string.size)
+        {
+            offset = root->raw_string.size;
+        }
+        if(offset < accel->line_offsets[line_idx])
+        {
+            line_idx = _MD_LineIndexFromOffset(accel, offset);
+        }
+        for(; line_idx + 1 < accel->line_count && accel->line_offsets[line_idx + 1] <= offset; line_idx += 1);
+        locs_out[i] = _MD_CodeLocFromLine(root, accel, line_idx, offset, flags);
+    }
+}
+
+//~ Tree/List Building
+
+MD_FUNCTION_IMPL MD_b32
+MD_NodeIsNil(MD_Node *node)
+{
+    return node == 0 || node == &_md_nil_node || node->kind == MD_NodeKind_Nil;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NilNode(void) { return &_md_nil_node; }
+
+// NOTE: A node's hash covers its subtree, so an edit invalidates the
+// hashes of its ancestors. Computing a hash caches it for the whole subtree,
+// so the walk can stop at the first ancestor without one. Tags are the
+// exception: their hashes are folded into the tagged node's without being
+// cached, so the walk passes through them.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_ClearStructuralHashes(MD_Node *node)
+{
+    for(MD_Node *n = node;
+        !MD_NodeIsNil(n) && (n->structural_hash_key != 0 || n->kind == MD_NodeKind_Tag);
+        n = n->parent)
+    {
+        n->structural_hash_key = 0;
+    }
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_MakeNode(MD_NodeKind kind, MD_String8 string, MD_String8 raw_string, MD_u64 offset)
+{
+    MD_Node *node = MD_PushArray(MD_Node, 1);
+    _MD_InitNode(node, kind, string, raw_string, offset);
+    node->id = _MD_MakeNodeId();
+    return node;
+}
+
+MD_FUNCTION_IMPL void
+MD_PushChild(MD_Node *parent, MD_Node *new_child)
+{
+    if (!MD_NodeIsNil(new_child))
+    {
+        _MD_ClearStructuralHashes(parent);
+        MD_NodeDblPushBack(parent->first_child, parent->last_child, new_child);
+        new_child->parent = parent;
+        new_child->index = parent->child_count;
+        parent->child_count += 1;
+    }
+}
+
+MD_FUNCTION_IMPL void
+MD_PushTag(MD_Node *node, MD_Node *tag)
+{
+    if (!MD_NodeIsNil(tag))
+    {
+        _MD_ClearStructuralHashes(node);
+        MD_NodeDblPushBack(node->first_tag, node->last_tag, tag);
+        tag->parent = node;
+        tag->index = node->tag_count;
+        node->tag_count += 1;
+        node->tag_bloom |= _MD_TagBloomFromString(tag->string);
+    }
+}
+
+MD_FUNCTION_IMPL MD_Node*
+MD_MakeList(void)
+{
+    MD_String8 empty = {0};
+    MD_Node *result = MD_MakeNode(MD_NodeKind_List, empty, empty, 0);
+    return(result);
+}
+
+MD_FUNCTION_IMPL MD_Node*
+MD_PushNewReference(MD_Node *list, MD_Node *target)
+{
+    MD_Node *n = MD_MakeNode(MD_NodeKind_Reference, target->string, target->raw_string, target->offset);
+    n->ref_target = target;
+    MD_PushChild(list, n);
+    return(n);
+}
+
+// NOTE: Drops the child array and name index of node, so that they are
+// rebuilt from its current child list on the next lookup.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_ResetChildAccel(MD_Node *node)
+{
+    if(node->accel != 0)
+    {
+        MD_NodeAccel *accel = node->accel;
+        accel->child_array_count = 0;
+        accel->name_slots = 0;
+        accel->name_hashes = 0;
+        accel->name_slot_cap = 0;
+        accel->name_count = 0;
+        accel->name_indexed_child_count = 0;
+        accel->name_last_indexed_child = 0;
+    }
+}
+
+// NOTE: Renumbers the nodes after one that was unlinked from a counted
+// list.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_RenumberFrom(MD_Node *first, MD_u64 index)
+{
+    for(MD_EachNode(node, first))
+    {
+        node->index = index;
+        index += 1;
+    }
+}
+
+MD_FUNCTION_IMPL void
+MD_RemoveChild(MD_Node *parent, MD_Node *child)
+{
+    if(!MD_NodeIsNil(child) && child->parent == parent)
+    {
+        _MD_ClearStructuralHashes(parent);
+        MD_Node *next = child->next;
+        MD_NodeDblRemove(parent->first_child, parent->last_child, child);
+        if(parent->child_count != 0)
+        {
+            parent->child_count -= 1;
+            _MD_RenumberFrom(next, child->index);
+        }
+        _MD_ResetChildAccel(parent);
+        child->next = child->prev = child->parent = MD_NilNode();
+        child->index = 0;
+    }
+}
+
+MD_FUNCTION_IMPL void
+MD_RemoveTag(MD_Node *node, MD_Node *tag)
+{
+    if(!MD_NodeIsNil(tag) && tag->parent == node)
+    {
+        _MD_ClearStructuralHashes(node);
+        MD_Node *next = tag->next;
+        MD_NodeDblRemove(node->first_tag, node->last_tag, tag);
+        if(node->tag_count != 0)
+        {
+            node->tag_count -= 1;
+            _MD_RenumberFrom(next, tag->index);
+            
+            //- a bloom filter can't drop a string, so it is rebuilt
+            node->tag_bloom = 0;
+            for(MD_EachNode(other, node->first_tag))
+            {
+                node->tag_bloom |= _MD_TagBloomFromString(other->string);
+            }
+        }
+        tag->next = tag->prev = tag->parent = MD_NilNode();
+        tag->index = 0;
+    }
+}
+
+// NOTE: Relinks the children of node in the order of sorted_children,
+// and drops lookup structures that depend on the old order.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_RelinkChildren(MD_Node *node, MD_NodeArray sorted_children)
+{
+    MD_Node *prev = MD_NilNode();
+    for(MD_u64 i = 0; i < sorted_children.count; i += 1)
+    {
+        MD_Node *child = sorted_children.v[i];
+        child->prev = prev;
+        child->index = i;
+        if(MD_NodeIsNil(prev))
+        {
+            node->first_child = child;
+        }
+        else
+        {
+            prev->next = child;
+        }
+        prev = child;
+    }
+    if(!MD_NodeIsNil(prev))
+    {
+        prev->next = MD_NilNode();
+        node->last_child = prev;
+    }
+    _MD_ResetChildAccel(node);
+    _MD_ClearStructuralHashes(node);
+}
+
+MD_FUNCTION_IMPL void
+MD_SortChildren(MD_Node *node, MD_NodeKeyFunction *key, void *user_data)
+{
+    if(!MD_NodeIsNil(node))
+    {
+        _MD_RelinkChildren(node, MD_NodeArraySort(MD_NodeArrayFromChildren(node), key, user_data));
+    }
+}
+
+MD_FUNCTION_IMPL void
+MD_SortChildrenByString(MD_Node *node, MD_NodeStringKeyFunction *key, void *user_data)
+{
+    if(!MD_NodeIsNil(node))
+    {
+        _MD_RelinkChildren(node, MD_NodeArraySortByString(MD_NodeArrayFromChildren(node), key, user_data));
+    }
+}
+
+//~ Deep Copy
+
+typedef struct _MD_CopyCtx _MD_CopyCtx;
+struct _MD_CopyCtx
+{
+    MD_Node *nodes;
+    MD_u64 node_count;
+    MD_u8 *strings;
+    MD_b32 keep_ids;
+    // NOTE: Originals to copies; only filled when the subtree has
+    // references, which are retargeted to copies of what they point at.
+    MD_Map copy_map;
+};
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_CopyCount(MD_Node *node, MD_u64 *count, MD_u64 *string_size, MD_u64 *reference_count)
+{
+    *count += 1;
+    *string_size += node->raw_string.size + node->prev_comment.size + node->next_comment.size;
+    if(node->string.str < node->raw_string.str ||
+       node->string.str + node->string.size > node->raw_string.str + node->raw_string.size)
+    {
+        *string_size += node->string.size;
+    }
+    if(!MD_NodeIsNil(node->ref_target))
+    {
+        *reference_count += 1;
+    }
+    for(MD_EachNode(tag, node->first_tag))
+    {
+        _MD_CopyCount(tag, count, string_size, reference_count);
+    }
+    for(MD_EachNode(child, MD_FirstChildFromNode(node)))
+    {
+        _MD_CopyCount(child, count, string_size, reference_count);
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_String8
+_MD_CopyString(_MD_CopyCtx *ctx, MD_String8 string)
+{
+    MD_String8 result = MD_S8(ctx->strings, string.size);
+    MD_MemoryCopy(ctx->strings, string.str, string.size);
+    ctx->strings += string.size;
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_CopyNode(_MD_CopyCtx *ctx, MD_Node *node)
+{
+    MD_Node *copy = ctx->nodes + ctx->node_count;
+    ctx->node_count += 1;
+    *copy = *node;
+    copy->next = copy->prev = copy->parent = MD_NilNode();
+    copy->first_child = copy->last_child = copy->first_tag = copy->last_tag = MD_NilNode();
+    copy->unexpanded = 0;
+    copy->accel = 0;
+    if(!ctx->keep_ids)
+    {
+        copy->id = _MD_MakeNodeId();
+    }
+    if(ctx->copy_map.bucket_count != 0)
+    {
+        MD_MapInsert(&ctx->copy_map, MD_MapKeyPtr(node), copy);
+    }
+    
+    //- strings; the string is usually part of the raw string, and stays so
+    copy->raw_string = _MD_CopyString(ctx, node->raw_string);
+    if(node->string.str < node->raw_string.str ||
+       node->string.str + node->string.size > node->raw_string.str + node->raw_string.size)
+    {
+        copy->string = _MD_CopyString(ctx, node->string);
+    }
+    else
+    {
+        copy->string.str = copy->raw_string.str + (node->string.str - node->raw_string.str);
+    }
+    copy->prev_comment = _MD_CopyString(ctx, node->prev_comment);
+    copy->next_comment = _MD_CopyString(ctx, node->next_comment);
+    
+    //- tags, then children; counts, indices, and cached hashes carry over
+    for(MD_EachNode(tag, node->first_tag))
+    {
+        MD_Node *tag_copy = _MD_CopyNode(ctx, tag);
+        MD_NodeDblPushBack(copy->first_tag, copy->last_tag, tag_copy);
+        tag_copy->parent = copy;
+    }
+    for(MD_EachNode(child, node->first_child))
+    {
+        MD_Node *child_copy = _MD_CopyNode(ctx, child);
+        MD_NodeDblPushBack(copy->first_child, copy->last_child, child_copy);
+        child_copy->parent = copy;
+    }
+    return copy;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_DeepCopy(MD_Node *node, MD_b32 keep_ids)
+{
+    MD_Node *result = MD_NilNode();
+    if(!MD_NodeIsNil(node))
+    {
+        //- count, expanding lazily-parsed sets
+        MD_u64 count = 0;
+        MD_u64 string_size = 0;
+        MD_u64 reference_count = 0;
+        _MD_CopyCount(node, &count, &string_size, &reference_count);
+        
+        //- copy into one block, nodes in preorder, then strings
+        _MD_CopyCtx ctx = MD_ZERO_STRUCT;
+        MD_u8 *block = MD_PushArray(MD_u8, count*sizeof(MD_Node) + string_size);
+        ctx.nodes = (MD_Node *)block;
+        ctx.strings = block + count*sizeof(MD_Node);
+        ctx.keep_ids = keep_ids;
+        if(reference_count != 0)
+        {
+            ctx.copy_map = MD_MapMakeBucketCount(count);
+        }
+        result = _MD_CopyNode(&ctx, node);
+        
+        //- retarget references into the subtree
+        for(MD_u64 i = 0; reference_count != 0 && i < count; i += 1)
+        {
+            MD_Node *copy = ctx.nodes + i;
+            MD_MapSlot *slot = MD_MapLookup(&ctx.copy_map, MD_MapKeyPtr(copy->ref_target));
+            if(!MD_NodeIsNil(copy->ref_target) && slot != 0)
+            {
+                copy->ref_target = (MD_Node *)slot->val;
+            }
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NodeDeepCopy(MD_Node *node)
+{
+    MD_Node *result = _MD_DeepCopy(node, 0);
+    if(!MD_NodeIsNil(result))
+    {
+        result->index = 0;
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_TreeCompact(MD_Node *root)
+{
+    MD_Node *result = _MD_DeepCopy(root, 1);
+    
+    //- take the old root's place in its parent
+    MD_Node *parent = root->parent;
+    if(!MD_NodeIsNil(parent))
+    {
+        MD_b32 is_tag = (root->kind == MD_NodeKind_Tag);
+        result->parent = parent;
+        result->prev = root->prev;
+        result->next = root->next;
+        if(!MD_NodeIsNil(root->prev))
+        {
+            root->prev->next = result;
+        }
+        else if(is_tag)
+        {
+            parent->first_tag = result;
+        }
+        else
+        {
+            parent->first_child = result;
+        }
+        if(!MD_NodeIsNil(root->next))
+        {
+            root->next->prev = result;
+        }
+        else if(is_tag)
+        {
+            parent->last_tag = result;
+        }
+        else
+        {
+            parent->last_child = result;
+        }
+        if(!is_tag)
+        {
+            _MD_ResetChildAccel(parent);
+        }
+    }
+    return result;
+}
+
+//~ Persistent Trees
+
+// NOTE: A version of a tree shares every subtree that an edit did not
+// touch with the versions before it. The copies that an edit makes keep the
+// IDs of the nodes they replace, so a node is found in any version by the
+// IDs of its ancestors, even when its own parent pointer leads into an older
+// version.
+//
+// Sibling lists are doubly linked, so a list cannot share any of its nodes
+// with the list it was copied from. An edit therefore copies every list on
+// the path from the root to the changed list, and costs time and memory in
+// proportion to the sum of their lengths, rather than to the depth alone.
+
+// NOTE: Returns the nodes from root down to the node with the IDs of node
+// and its ancestors, or a count of zero when this version has no such node.
+MD_PRIVATE_FUNCTION_IMPL MD_Node **
+_MD_PersistentPathFromNode(MD_Node *root, MD_Node *node, MD_u64 *count_out)
+{
+    //- IDs of the node and its ancestors, from the top
+    MD_u64 depth = 0;
+    for(MD_Node *n = node; !MD_NodeIsNil(n); n = n->parent)
+    {
+        depth += 1;
+    }
+    MD_u32 *ids = MD_PushArray(MD_u32, depth + 1);
+    MD_Node **path_out = MD_PushArray(MD_Node *, depth + 1);
+    depth = 0;
+    for(MD_Node *n = node; !MD_NodeIsNil(n); n = n->parent)
+    {
+        ids[depth] = n->id;
+        depth += 1;
+    }
+    
+    //- follow them down from this version's root
+    MD_u64 count = 0;
+    if(depth > 0 && !MD_NodeIsNil(root) && ids[depth-1] == root->id)
+    {
+        path_out[0] = root;
+        count = 1;
+        for(MD_u64 i = depth - 1; i > 0; i -= 1)
+        {
+            MD_Node *cur = path_out[count-1];
+            MD_Node *next = MD_NilNode();
+            for(MD_EachNode(child, MD_FirstChildFromNode(cur)))
+            {
+                if(child->id == ids[i-1]) { next = child; break; }
+            }
+            for(MD_Node *tag = cur->first_tag; MD_NodeIsNil(next) && !MD_NodeIsNil(tag); tag = tag->next)
+            {
+                if(tag->id == ids[i-1]) { next = tag; }
+            }
+            if(MD_NodeIsNil(next))
+            {
+                count = 0;
+                break;
+            }
+            path_out[count] = next;
+            count += 1;
+        }
+    }
+    *count_out = count;
+    return path_out;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_PersistentCopyNode(MD_Node *node)
+{
+    MD_Node *copy = MD_PushArray(MD_Node, 1);
+    *copy = *node;
+    copy->next = copy->prev = copy->parent = MD_NilNode();
+    copy->accel = 0;
+    return copy;
+}
+
+// NOTE: Copies one list of new_parent's, which was copied from a node
+// of the last version; every node in it is copied, so that the sibling links
+// of the old version are left alone. `target` is replaced by `replacement`,
+// or removed when that is nil; or, `insertion` is placed after `target`, or
+// first when that is nil. Returns whether the target was found.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_PersistentCopyList(MD_Node *new_parent, MD_b32 tags, MD_Node *target, MD_Node *replacement,
+                       MD_Node *insertion)
+{
+    MD_Node *first = tags ? new_parent->first_tag : MD_FirstChildFromNode(new_parent);
+    if(tags)
+    {
+        new_parent->first_tag = new_parent->last_tag = MD_NilNode();
+        new_parent->tag_count = 0;
+        new_parent->tag_bloom = 0;
+    }
+    else
+    {
+        new_parent->first_child = new_parent->last_child = MD_NilNode();
+        new_parent->child_count = 0;
+    }
+    
+    MD_b32 found = MD_NodeIsNil(target);
+    MD_Node *insert_first = found ? insertion : MD_NilNode();
+    for(MD_Node *n = insert_first, *old = first; !MD_NodeIsNil(old) || !MD_NodeIsNil(n);)
+    {
+        MD_Node *push = MD_NilNode();
+        if(!MD_NodeIsNil(n))
+        {
+            push = n;
+            n = MD_NilNode();
+        }
+        else
+        {
+            if(!MD_NodeIsNil(target) && old->id == target->id)
+            {
+                found = 1;
+                push = MD_NodeIsNil(insertion) ? replacement : _MD_PersistentCopyNode(old);
+                n = insertion;
+            }
+            else
+            {
+                push = _MD_PersistentCopyNode(old);
+            }
+            old = old->next;
+        }
+        if(!MD_NodeIsNil(push))
+        {
+            if(tags) { MD_PushTag(new_parent, push); }
+            else     { MD_PushChild(new_parent, push); }
+        }
+    }
+    return found;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_PersistentEdit(MD_Node *root, MD_Node *list_owner, MD_b32 tags, MD_Node *target, MD_Node *replacement,
+                   MD_Node *insertion)
+{
+    MD_Node *result = root;
+    MD_u64 count = 0;
+    MD_Node **path = _MD_PersistentPathFromNode(root, list_owner, &count);
+    if(count != 0)
+    {
+        //- copy the node whose list changes, then each ancestor, linking in
+        // the copy below in place of the node it was made from
+        MD_Node *copy = _MD_PersistentCopyNode(path[count-1]);
+        copy->structural_hash_key = 0;
+        if(_MD_PersistentCopyList(copy, tags, target, replacement, insertion))
+        {
+            for(MD_u64 i = count - 1; i > 0; i -= 1)
+            {
+                MD_Node *below = copy;
+                copy = _MD_PersistentCopyNode(path[i-1]);
+                copy->structural_hash_key = 0;
+                _MD_PersistentCopyList(copy, below->kind == MD_NodeKind_Tag, below, below, MD_NilNode());
+            }
+            result = copy;
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_PersistentInsertChild(MD_Node *root, MD_Node *parent, MD_Node *prev_child, MD_Node *new_child)
+{
+    return _MD_PersistentEdit(root, parent, 0, prev_child, MD_NilNode(), new_child);
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_PersistentInsertTag(MD_Node *root, MD_Node *node, MD_Node *prev_tag, MD_Node *new_tag)
+{
+    return _MD_PersistentEdit(root, node, 1, prev_tag, MD_NilNode(), new_tag);
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_PersistentRemove(MD_Node *root, MD_Node *node)
+{
+    return MD_PersistentReplace(root, node, MD_NilNode());
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_PersistentReplace(MD_Node *root, MD_Node *node, MD_Node *replacement)
+{
+    MD_Node *result = root;
+    if(!MD_NodeIsNil(node->parent))
+    {
+        result = _MD_PersistentEdit(root, node->parent, node->kind == MD_NodeKind_Tag, node, replacement,
+                                    MD_NilNode());
+    }
+    return result;
+}
+
+//~ Introspection Helpers
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NodeFromString(MD_Node *first, MD_Node *one_past_last, MD_String8 string, MD_MatchFlags flags)
+{
+    MD_Node *result = MD_NilNode();
+    for(MD_Node *node = first; !MD_NodeIsNil(node) && node != one_past_last; node = node->next)
+    {
+        if(MD_S8Match(string, node->string, flags))
+        {
+            result = node;
+            break;
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NodeFromIndex(MD_Node *first, MD_Node *one_past_last, int n)
+{
+    MD_Node *result = MD_NilNode();
+    if(n >= 0)
+    {
+        int idx = 0;
+        for(MD_Node *node = first; !MD_NodeIsNil(node) && node != one_past_last; node = node->next, idx += 1)
+        {
+            if(idx == n)
+            {
+                result = node;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NodeFromFlags(MD_Node *first, MD_Node *one_past_last, MD_NodeFlags flags)
+{
+    MD_Node *result = MD_NilNode();
+    for(MD_Node *n = first; n != one_past_last && !MD_NodeIsNil(n); n = n->next)
+    {
+        if(n->flags & flags)
+        {
+            result = n;
+            break;
+        }
+    }
+    return result;
+}
+
+// NOTE: Nodes only linked with the MD_NodeDbl* macros have no index, and
+// are counted by walking back through their list.
+MD_FUNCTION_IMPL int
+MD_IndexFromNode(MD_Node *node)
+{
+    MD_Node *parent = node->parent;
+    MD_u64 count = 0;
+    if(!MD_NodeIsNil(parent))
+    {
+        count = (node->kind == MD_NodeKind_Tag ? parent->tag_count : parent->child_count);
+    }
+    int result = 0;
+    if(count != 0 && (node->index != 0 || MD_NodeIsNil(node->prev)))
+    {
+        result = (int)node->index;
+    }
+    else
+    {
+        for(MD_Node *prev = node->prev; !MD_NodeIsNil(prev); prev = prev->prev)
+        {
+            result += 1;
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_RootFromNode(MD_Node *node)
+{
+    MD_Node *parent = node;
+    for(MD_Node *p = parent; !MD_NodeIsNil(p); p = p->parent)
+    {
+        parent = p;
+    }
+    return parent;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_FirstChildFromNode(MD_Node *node)
+{
+    if(node->unexpanded != 0)
+    {
+        MD_ExpandNode(node);
+    }
+    return node->first_child;
+}
+
+//- child name index
+
+// NOTE: Nodes with fewer children are searched linearly, unless they
+// were indexed explicitly.
+#define _MD_NAME_INDEX_MIN_COUNT 32
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_NameIndexInsert(MD_NodeAccel *accel, MD_Node *child, MD_u64 hash)
+{
+    MD_u64 mask = accel->name_slot_cap - 1;
+    for(MD_u64 slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        if(accel->name_slots[slot] == 0)
+        {
+            accel->name_slots[slot] = child;
+            accel->name_hashes[slot] = hash;
+            accel->name_count += 1;
+            break;
+        }
+        // NOTE: keep the first child with a given string
+        if(accel->name_hashes[slot] == hash && MD_S8Match(accel->name_slots[slot]->string, child->string, 0))
+        {
+            break;
+        }
+    }
+}
+
+MD_FUNCTION_IMPL void
+MD_IndexChildren(MD_Node *node)
+{
+    MD_Node *first = MD_FirstChildFromNode(node);
+    MD_NodeAccel *accel = node->accel;
+    if(!MD_NodeIsNil(node) &&
+       (accel == 0 || accel->name_indexed_child_count != node->child_count || accel->name_slot_cap == 0) &&
+       !_MD_NodeIsReadOnly(node))
+    {
+        accel = _MD_AccelFromNode(node);
+        //- grow, keeping the table at most half full
+        if(accel->name_slot_cap < 2*node->child_count || accel->name_slot_cap == 0)
+        {
+            MD_u64 new_cap = 16;
+            for(; new_cap < 2*node->child_count; new_cap *= 2);
+            MD_Node **old_slots = accel->name_slots;
+            MD_u64 *old_hashes = accel->name_hashes;
+            MD_u64 old_cap = accel->name_slot_cap;
+            accel->name_slots = MD_PushArray(MD_Node *, new_cap);
+            accel->name_hashes = MD_PushArray(MD_u64, new_cap);
+            accel->name_slot_cap = new_cap;
+            accel->name_count = 0;
+            for(MD_u64 i = 0; i < old_cap; i += 1)
+            {
+                if(old_slots[i] != 0)
+                {
+                    _MD_NameIndexInsert(accel, old_slots[i], old_hashes[i]);
+                }
+            }
+        }
+        
+        //- index children pushed since the last call
+        MD_Node *child = (accel->name_last_indexed_child == 0 ? first :
+                          accel->name_last_indexed_child->next);
+        for(; !MD_NodeIsNil(child); child = child->next)
+        {
+            _MD_NameIndexInsert(accel, child, MD_HashStr(child->string));
+            accel->name_last_indexed_child = child;
+            accel->name_indexed_child_count += 1;
+        }
+    }
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_ChildFromString(MD_Node *node, MD_String8 child_string, MD_MatchFlags flags)
+{
+    MD_Node *result = MD_NilNode();
+    MD_Node *first = MD_FirstChildFromNode(node);
+    MD_b32 exact = !(flags & (MD_StringMatchFlag_CaseInsensitive |
+                              MD_StringMatchFlag_RightSideSloppy |
+                              MD_StringMatchFlag_SlashInsensitive));
+    MD_b32 indexed = (node->accel != 0 && node->accel->name_slot_cap != 0);
+    if(exact && (indexed || node->child_count >= _MD_NAME_INDEX_MIN_COUNT))
+    {
+        MD_IndexChildren(node);
+        indexed = (node->accel != 0 && node->accel->name_slot_cap != 0);
+    }
+    if(exact && indexed)
+    {
+        MD_NodeAccel *accel = node->accel;
+        MD_u64 hash = MD_HashStr(child_string);
+        MD_u64 mask = accel->name_slot_cap - 1;
+        for(MD_u64 slot = hash & mask; accel->name_slots[slot] != 0; slot = (slot + 1) & mask)
+        {
+            if(accel->name_hashes[slot] == hash && MD_S8Match(accel->name_slots[slot]->string, child_string, 0))
+            {
+                result = accel->name_slots[slot];
+                break;
+            }
+        }
+    }
+    else
+    {
+        result = MD_NodeFromString(first, MD_NilNode(), child_string, flags);
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_TagFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags)
+{
+    MD_Node *result = MD_NilNode();
+    MD_b32 exact = !(flags & (MD_StringMatchFlag_CaseInsensitive |
+                              MD_StringMatchFlag_RightSideSloppy |
+                              MD_StringMatchFlag_SlashInsensitive));
+    
+    // NOTE: Tag lists built without MD_PushTag have no tag_count or
+    // tag_bloom, and are always searched.
+    MD_b32 rejected = MD_NodeIsNil(node->first_tag);
+    if(!rejected && exact && node->tag_count != 0)
+    {
+        MD_u64 bloom = _MD_TagBloomFromString(tag_string);
+        rejected = ((node->tag_bloom & bloom) != bloom);
+    }
+    if(!rejected)
+    {
+        result = MD_NodeFromString(node->first_tag, MD_NilNode(), tag_string, flags);
+    }
+    return result;
+}
+
+// NOTE: Short lists are walked; longer ones are indexed through the
+// child array, which is built the first time it is needed.
+#define _MD_CHILD_ARRAY_MIN_COUNT 16
+
+MD_FUNCTION_IMPL MD_Node *
+MD_ChildFromIndex(MD_Node *node, int n)
+{
+    MD_Node *result = MD_NilNode();
+    MD_Node *first = MD_FirstChildFromNode(node);
+    if(node->child_count < _MD_CHILD_ARRAY_MIN_COUNT)
+    {
+        result = MD_NodeFromIndex(first, MD_NilNode(), n);
+    }
+    else if(n >= 0 && (MD_u64)n < node->child_count)
+    {
+        result = MD_ChildArrayFromNode(node)[n];
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_TagFromIndex(MD_Node *node, int n)
+{
+    return MD_NodeFromIndex(node->first_tag, MD_NilNode(), n);
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_TagArgFromIndex(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags, int n)
+{
+    MD_Node *tag = MD_TagFromString(node, tag_string, flags);
+    return MD_ChildFromIndex(tag, n);
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_TagArgFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags tag_str_flags, MD_String8 arg_string, MD_MatchFlags arg_str_flags)
+{
+    MD_Node *tag = MD_TagFromString(node, tag_string, tag_str_flags);
+    MD_Node *arg = MD_ChildFromString(tag, arg_string, arg_str_flags);
+    return arg;
+}
+
+MD_FUNCTION_IMPL MD_b32
+MD_NodeHasTag(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags)
+{
+    return !MD_NodeIsNil(MD_TagFromString(node, tag_string, flags));
+}
+
+// NOTE: Lists that were only linked with the MD_NodeDbl* macros have no
+// counts, and are walked.
+MD_FUNCTION_IMPL MD_i64
+MD_ChildCountFromNode(MD_Node *node)
+{
+    MD_Node *first = MD_FirstChildFromNode(node);
+    MD_i64 result = (MD_i64)node->child_count;
+    if(result == 0)
+    {
+        for(MD_EachNode(child, first))
+        {
+            result += 1;
         }
     }
-    end_parse:;
-    
-    //- rjf: push missing closer error, if we have one
-    if(set_opener != 0 && got_closer == 0)
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_i64
+MD_TagCountFromNode(MD_Node *node)
+{
+    MD_i64 result = (MD_i64)node->tag_count;
+    if(result == 0)
     {
-        // NOTE(rjf): @error We didn't get a closer for the set
-        MD_Message *error = MD_MakeTokenError(string, initial_token, MD_MessageKind_CatastrophicError,
-                                              MD_S8Fmt("Unbalanced \"%c\"", set_opener));
-        MD_MessageListPush(&result.errors, error);
+        for(MD_EachNode(tag, node->first_tag))
+        {
+            result += 1;
+        }
     }
-    
-    //- rjf: push empty implicit set error,
-    if(close_with_separator && parsed_child_count == 0)
+    return result;
+}
+
+// NOTE: Children may only have been pushed since the array was last
+// filled, so it is extended from its last entry rather than rebuilt. On
+// a read-only tree, an array that was not built beforehand would be filled
+// anew on each call; MD_HotReloadPoll builds one for every node with children
+// before it marks a tree read-only, so that does not happen.
+MD_FUNCTION_IMPL MD_Node **
+MD_ChildArrayFromNode(MD_Node *node)
+{
+    MD_Node *first = MD_FirstChildFromNode(node);
+    MD_NodeAccel *accel = node->accel;
+    MD_NodeAccel scratch = MD_ZERO_STRUCT;
+    if(accel == 0 || accel->child_array_count != node->child_count)
     {
-        // NOTE(rjf): @error No empty implicitly-delimited sets
-        MD_Message *error = MD_MakeTokenError(string, initial_token, MD_MessageKind_Error,
-                                              MD_S8Lit("Empty implicitly-delimited node list"));
-        MD_MessageListPush(&result.errors, error);
+        accel = (_MD_NodeIsReadOnly(node) ? &scratch : _MD_AccelFromNode(node));
+        if(accel->child_array_cap < node->child_count)
+        {
+            MD_u64 new_cap = accel->child_array_cap ? accel->child_array_cap : 16;
+            for(; new_cap < node->child_count; new_cap *= 2);
+            MD_Node **new_array = MD_PushArray(MD_Node *, new_cap);
+            MD_MemoryCopy(new_array, accel->child_array, sizeof(MD_Node *)*accel->child_array_count);
+            accel->child_array = new_array;
+            accel->child_array_cap = new_cap;
+        }
+        MD_Node *child = (accel->child_array_count == 0 ? first :
+                          accel->child_array[accel->child_array_count - 1]->next);
+        for(; !MD_NodeIsNil(child) && accel->child_array_count < node->child_count; child = child->next)
+        {
+            accel->child_array[accel->child_array_count] = child;
+            accel->child_array_count += 1;
+        }
+    }
+    return accel->child_array;
+}
+
+MD_FUNCTION_IMPL MD_Node *
+MD_NodeFromReference(MD_Node *node)
+{
+    MD_Node *result = node;
+    while(result->kind == MD_NodeKind_Reference)
+    {
+        result = result->ref_target;
     }
-    
-    //- rjf: fill result info
-    result.node = parent->first_child;
-    result.last_node = parent->last_child;
-    result.string_advance= off - offset;
-    
     return result;
 }
 
-// TODO(rjf): Inline this in the only place it is called
-MD_FUNCTION_IMPL MD_ParseResult
-_MD_ParseTagList(MD_String8 string, MD_u64 offset)
+//~ Frozen Trees
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_FreezeCount(MD_Node *node, MD_u64 *count, MD_u64 *blob_size)
 {
-    MD_ParseResult result = MD_ParseResultZero();
-    MD_u64 off = offset;
+    *count += 1;
+    *blob_size += node->string.size;
+    for(MD_EachNode(tag, node->first_tag))
+    {
+        _MD_FreezeCount(tag, count, blob_size);
+    }
+    for(MD_EachNode(child, MD_FirstChildFromNode(node)))
+    {
+        _MD_FreezeCount(child, count, blob_size);
+    }
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u32
+_MD_FreezeNode(MD_FrozenTree *tree, MD_Node *node, MD_u32 parent)
+{
+    MD_u32 i = (MD_u32)tree->count;
+    tree->count += 1;
+    tree->kinds[i] = (MD_u8)node->kind;
+    tree->flags[i] = node->flags;
+    tree->parents[i] = parent;
+    tree->offsets[i] = node->offset;
+    tree->nodes[i] = node;
+    tree->string_offsets[i] = tree->blob_size;
+    tree->string_sizes[i] = node->string.size;
+    MD_MemoryCopy(tree->blob + tree->blob_size, node->string.str, node->string.size);
+    tree->blob_size += node->string.size;
     
-    for(;off < string.size;)
+    //- tags, then children, each linked to the last
+    MD_u32 prev = 0;
+    for(MD_EachNode(tag, node->first_tag))
     {
-        //- rjf: parse @ symbol, signifying start of tag
-        off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-        MD_Token next_token = MD_TokenFromString(MD_S8Skip(string, off));
-        if(next_token.kind != MD_TokenKind_Reserved ||
-           next_token.string.str[0] != '@')
+        MD_u32 tag_i = _MD_FreezeNode(tree, tag, i);
+        if(prev != 0)
         {
-            break;
+            tree->next_siblings[prev] = tag_i;
         }
-        off += next_token.raw_string.size;
-        
-        //- rjf: parse string of tag node
-        MD_Token name = MD_TokenFromString(MD_S8Skip(string, off));
-        MD_u64 name_off = off;
-        if((name.kind & MD_TokenGroup_Label) == 0)
+        prev = tag_i;
+        tree->tag_counts[i] += 1;
+    }
+    prev = 0;
+    for(MD_EachNode(child, node->first_child))
+    {
+        MD_u32 child_i = _MD_FreezeNode(tree, child, i);
+        if(prev != 0)
         {
-            // NOTE(rjf): @error Improper token for tag string
-            MD_Message *error = MD_MakeTokenError(string, name, MD_MessageKind_Error,
-                                                  MD_S8Fmt("\"%.*s\" is not a proper tag label",
-                                                           MD_S8VArg(name.raw_string)));
-            MD_MessageListPush(&result.errors, error);
-            break;
+            tree->next_siblings[prev] = child_i;
         }
-        off += name.raw_string.size;
-        
-        //- rjf: build tag
-        MD_Node *tag = MD_MakeNode(MD_NodeKind_Tag, name.string, name.raw_string, name_off);
-        
-        //- rjf: parse tag arguments
-        MD_Token open_paren = MD_TokenFromString(MD_S8Skip(string, off));
-        MD_ParseResult args_parse = MD_ParseResultZero();
-        if(open_paren.kind == MD_TokenKind_Reserved &&
-           open_paren.string.str[0] == '(')
+        else
         {
-            args_parse = MD_ParseNodeSet(string, off, tag, MD_ParseSetRule_EndOnDelimiter);
-            MD_MessageListConcat(&result.errors, &args_parse.errors);
+            tree->first_children[i] = child_i;
         }
-        off += args_parse.string_advance;
-        
-        //- rjf: push tag to result
-        MD_NodeDblPushBack(result.node, result.last_node, tag);
+        prev = child_i;
+        tree->child_counts[i] += 1;
     }
     
-    //- rjf: fill result
-    result.string_advance= off - offset;
-    
-    return result;
+    tree->subtree_sizes[i] = (MD_u32)(tree->count - i);
+    return i;
 }
 
-MD_FUNCTION_IMPL MD_ParseResult
-MD_ParseOneNode(MD_String8 string, MD_u64 offset)
+MD_FUNCTION_IMPL MD_FrozenTree
+MD_FreezeTree(MD_Node *root)
 {
-    MD_ParseResult result = MD_ParseResultZero();
-    MD_u64 off = offset;
-    
-    //- rjf: parse pre-comment
-    MD_String8 prev_comment = MD_ZERO_STRUCT;
+    MD_FrozenTree tree = MD_ZERO_STRUCT;
+    if(!MD_NodeIsNil(root))
     {
-        MD_Token comment_token = MD_ZERO_STRUCT;
-        for(;off < string.size;)
+        //- count, expanding lazily-parsed sets
+        MD_u64 count = 0;
+        MD_u64 blob_size = 0;
+        _MD_FreezeCount(root, &count, &blob_size);
+        
+        //- fill
+        tree.kinds          = MD_PushArrayZero(MD_u8, count);
+        tree.flags          = MD_PushArrayZero(MD_NodeFlags, count);
+        tree.subtree_sizes  = MD_PushArrayZero(MD_u32, count);
+        tree.parents        = MD_PushArrayZero(MD_u32, count);
+        tree.next_siblings  = MD_PushArrayZero(MD_u32, count);
+        tree.first_children = MD_PushArrayZero(MD_u32, count);
+        tree.child_counts   = MD_PushArrayZero(MD_u32, count);
+        tree.tag_counts     = MD_PushArrayZero(MD_u32, count);
+        tree.offsets        = MD_PushArrayZero(MD_u64, count);
+        tree.string_offsets = MD_PushArrayZero(MD_u64, count);
+        tree.string_sizes   = MD_PushArrayZero(MD_u64, count);
+        tree.blob           = MD_PushArrayZero(MD_u8, blob_size + 1);
+        tree.nodes          = MD_PushArrayZero(MD_Node *, count);
+        _MD_FreezeNode(&tree, root, 0);
+    }
+    return tree;
+}
+
+MD_FUNCTION_IMPL MD_String8
+MD_StringFromFrozenNode(MD_FrozenTree *tree, MD_u32 i)
+{
+    return MD_S8(tree->blob + tree->string_offsets[i], tree->string_sizes[i]);
+}
+
+MD_FUNCTION_IMPL MD_u64
+MD_FrozenIndicesFromKind(MD_FrozenTree *tree, MD_u32 first, MD_u32 one_past_last,
+                         MD_NodeKind kind, MD_u32 *indices_out)
+{
+    MD_u64 count = 0;
+    MD_u32 i = first;
+#if MD_ARCH_X64
+    __m128i wanted = _mm_set1_epi8((char)kind);
+    for(; i + 16 <= one_past_last; i += 16)
+    {
+        __m128i kinds = _mm_loadu_si128((__m128i *)(tree->kinds + i));
+        MD_u64 mask = (MD_u64)_mm_movemask_epi8(_mm_cmpeq_epi8(kinds, wanted));
+        for(; mask != 0; mask &= mask - 1)
         {
-            MD_Token token = MD_TokenFromString(MD_S8Skip(string, off));
-            if(token.kind == MD_TokenKind_Comment)
-            {
-                off += token.raw_string.size;
-                comment_token = token;
-            }
-            else if(token.kind == MD_TokenKind_Newline)
-            {
-                off += token.raw_string.size;
-                MD_Token next_token = MD_TokenFromString(MD_S8Skip(string, off));
-                if(next_token.kind == MD_TokenKind_Comment)
-                {
-                    // NOTE(mal): If more than one comment, use the last comment
-                    comment_token = next_token;
-                }
-                else if(next_token.kind == MD_TokenKind_Newline)
-                {
-                    MD_MemoryZero(&comment_token, sizeof(comment_token));
-                }
-            }
-            else if((token.kind & MD_TokenGroup_Whitespace) != 0)
-            {
-                off += token.raw_string.size;
-            }
-            else
-            {
-                break;
-            }
-            prev_comment = comment_token.string;
+            indices_out[count] = i + (MD_u32)_MD_CountTrailingZeros64(mask);
+            count += 1;
+        }
+    }
+#endif
+    for(; i < one_past_last; i += 1)
+    {
+        if(tree->kinds[i] == kind)
+        {
+            indices_out[count] = i;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+MD_FUNCTION_IMPL MD_u64
+MD_FrozenIndicesFromFlags(MD_FrozenTree *tree, MD_u32 first, MD_u32 one_past_last,
+                          MD_NodeFlags flags, MD_u32 *indices_out)
+{
+    MD_u64 count = 0;
+    MD_u32 i = first;
+#if MD_ARCH_X64
+    // NOTE: Two nodes at a time; a node is picked when either 32-bit half
+    // of its masked flags is nonzero.
+    __m128i wanted = _mm_set1_epi64x((long long)flags);
+    for(; i + 2 <= one_past_last; i += 2)
+    {
+        __m128i masked = _mm_and_si128(_mm_loadu_si128((__m128i *)(tree->flags + i)), wanted);
+        int zero_halves = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(masked, _mm_setzero_si128())));
+        if((zero_halves & 0x3) != 0x3)
+        {
+            indices_out[count] = i;
+            count += 1;
+        }
+        if((zero_halves & 0xC) != 0xC)
+        {
+            indices_out[count] = i + 1;
+            count += 1;
+        }
+    }
+#endif
+    for(; i < one_past_last; i += 1)
+    {
+        if(tree->flags[i] & flags)
+        {
+            indices_out[count] = i;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+//~ Error/Warning Helpers
+
+MD_FUNCTION_IMPL void
+MD_PrintMessage(FILE *out, MD_CodeLoc loc, MD_MessageKind kind, MD_String8 str)
+{
+    const char *kind_name = "";
+    switch (kind){
+        default: break;
+        case MD_MessageKind_Note: kind_name = "note: "; break;
+        case MD_MessageKind_Warning: kind_name = "warning: "; break;
+        case MD_MessageKind_Error: kind_name = "error: "; break;
+        case MD_MessageKind_CatastrophicError: kind_name = "fatal error: "; break;
+    }
+    fprintf(out, "%.*s:%i:%i: %s%.*s\n",
+            MD_S8VArg(loc.filename), loc.line, loc.column,
+            kind_name, MD_S8VArg(str));
+}
+
+MD_FUNCTION_IMPL void
+MD_PrintMessageFmt(FILE *out, MD_CodeLoc loc, MD_MessageKind kind, char *fmt, ...)
+{
+    // TODO(allen): use scratch
+    va_list args;
+    va_start(args, fmt);
+    MD_PrintMessage(out, loc, kind, MD_S8FmtV(fmt, args));
+    va_end(args);
+}
+
+MD_FUNCTION_IMPL void
+MD_PrintNodeMessage(FILE *out, MD_Node *node, MD_MessageKind kind, MD_String8 str)
+{
+    MD_CodeLoc loc = MD_CodeLocFromNode(node);
+    MD_PrintMessage(out, loc, kind, str);
+}
+
+MD_FUNCTION_IMPL void
+MD_PrintNodeMessageFmt(FILE *out, MD_Node *node, MD_MessageKind kind, char *fmt, ...)
+{
+    // TODO(allen): use scratch
+    va_list args;
+    va_start(args, fmt);
+    MD_PrintNodeMessage(out, node, kind, MD_S8FmtV(fmt, args));
+    va_end(args);
+}
+
+//~ Tree Comparison/Verification
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_HashMix(MD_u64 h, MD_u64 v)
+{
+    h ^= v;
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    h = h ^ (h >> 31);
+    return h;
+}
+
+// NOTE: Characters are folded the way MD_S8Match compares them, so that
+// strings which match under the flags hash the same.
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_HashStrWithFlags(MD_String8 string, MD_MatchFlags flags)
+{
+    MD_u64 result = 5381;
+    for(MD_u64 i = 0; i < string.size; i += 1)
+    {
+        MD_u8 c = string.str[i];
+        if(flags & MD_StringMatchFlag_CaseInsensitive)
+        {
+            c = MD_CharToLower(c);
         }
+        if(flags & MD_StringMatchFlag_SlashInsensitive)
+        {
+            c = MD_CharToForwardSlash(c);
+        }
+        result = ((result << 5) + result) + c;
     }
-    
-    //- rjf: parse tag list
-    MD_ParseResult tags_parse = _MD_ParseTagList(string, off);
-    off += tags_parse.string_advance;
-    MD_MessageListConcat(&result.errors, &tags_parse.errors);
-    
-    //- rjf: parse node
-    MD_Node *parsed_node = MD_NilNode();
-    MD_ParseResult children_parse = MD_ParseResultZero();
-    retry:;
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_StructuralHash(MD_Node *node, MD_MatchFlags flags, MD_b32 cache)
+{
+    MD_u64 result = 0;
+    if(!MD_NodeIsNil(node) && node->structural_hash_key == flags + 1)
     {
-        //- rjf: try to parse an unnamed set
-        off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-        MD_Token unnamed_set_opener = MD_TokenFromString(MD_S8Skip(string, off));
-        if(unnamed_set_opener.kind == MD_TokenKind_Reserved)
+        result = node->structural_hash;
+    }
+    else
+    {
+        //- the node itself
+        result = _MD_HashMix((MD_u64)node->kind, _MD_HashStrWithFlags(node->string, flags));
+        
+        //- tags, as MD_NodeMatch compares them
+        if(node->kind != MD_NodeKind_Tag && (flags & MD_NodeMatchFlag_Tags))
         {
-            MD_u8 c = unnamed_set_opener.string.str[0];
-            if (c == '(' || c == '{' || c == '[')
-            {
-                parsed_node = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit(""), MD_S8Lit(""),
-                                          unnamed_set_opener.raw_string.str - string.str);
-                children_parse = MD_ParseNodeSet(string, off, parsed_node, MD_ParseSetRule_EndOnDelimiter);
-                off += children_parse.string_advance;
-                MD_MessageListConcat(&result.errors, &children_parse.errors);
-            }
-            else if (c == ')' || c == '}' || c == ']')
+            for(MD_EachNode(tag, node->first_tag))
             {
-                // NOTE(rjf): @error Unexpected set closing symbol
-                MD_Message *error = MD_MakeTokenError(string, unnamed_set_opener,
-                                                      MD_MessageKind_CatastrophicError,
-                                                      MD_S8Fmt("Unbalanced \"%c\"", c));
-                MD_MessageListPush(&result.errors, error);
-                off += unnamed_set_opener.raw_string.size;
-            }
-            else
-            {
-                // NOTE(rjf): @error Unexpected reserved symbol
-                MD_Message *error = MD_MakeTokenError(string, unnamed_set_opener,
-                                                      MD_MessageKind_Error, 
-                                                      MD_S8Fmt("Unexpected reserved symbol \"%c\"", c));
-                MD_MessageListPush(&result.errors, error);
-                off += unnamed_set_opener.raw_string.size;
+                MD_u64 tag_hash = _MD_HashMix((MD_u64)tag->kind, _MD_HashStrWithFlags(tag->string, flags));
+                if(flags & MD_NodeMatchFlag_TagArguments)
+                {
+                    for(MD_EachNode(arg, tag->first_child))
+                    {
+                        tag_hash = _MD_HashMix(tag_hash, _MD_StructuralHash(arg, flags, cache));
+                    }
+                }
+                result = _MD_HashMix(result, tag_hash);
             }
-            goto end_parse;
-            
         }
         
-        //- rjf: try to parse regular node, with/without children
-        off += MD_LexAdvanceFromSkips(MD_S8Skip(string, off), MD_TokenGroup_Irregular);
-        MD_Token label_name = MD_TokenFromString(MD_S8Skip(string, off));
-        if((label_name.kind & MD_TokenGroup_Label) != 0)
+        //- children, as MD_NodeDeepMatch compares them
+        result = _MD_HashMix(result, UINT64_C(0x9e3779b97f4a7c15));
+        for(MD_EachNode(child, MD_FirstChildFromNode(node)))
         {
-            off += label_name.raw_string.size;
-            parsed_node = MD_MakeNode(MD_NodeKind_Main, label_name.string, label_name.raw_string,
-                                      label_name.raw_string.str - string.str);
-            parsed_node->flags |= label_name.node_flags;
-            
-            //- rjf: try to parse children for this node
-            MD_u64 colon_check_off = off;
-            colon_check_off += MD_LexAdvanceFromSkips(MD_S8Skip(string, colon_check_off), MD_TokenGroup_Irregular);
-            MD_Token colon = MD_TokenFromString(MD_S8Skip(string, colon_check_off));
-            if(colon.kind == MD_TokenKind_Reserved &&
-               colon.string.str[0] == ':')
-            {
-                colon_check_off += colon.raw_string.size;
-                off = colon_check_off;
-                
-                children_parse = MD_ParseNodeSet(string, off, parsed_node, MD_ParseSetRule_EndOnDelimiter);
-                off += children_parse.string_advance;
-                MD_MessageListConcat(&result.errors, &children_parse.errors);
-            }
-            goto end_parse;
+            result = _MD_HashMix(result, _MD_StructuralHash(child, flags, cache));
         }
         
-        //- rjf: collect bad token
-        MD_Token bad_token = MD_TokenFromString(MD_S8Skip(string, off));
-        if(bad_token.kind & MD_TokenGroup_Error)
+        if(cache && !MD_NodeIsNil(node))
         {
-            off += bad_token.raw_string.size;
-            
-            switch (bad_token.kind){
-                case MD_TokenKind_BadCharacter:
+            node->structural_hash = result;
+            node->structural_hash_key = flags + 1;
+        }
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_u64
+MD_NodeStructuralHash(MD_Node *node, MD_MatchFlags flags)
+{
+    flags &= (MD_StringMatchFlag_CaseInsensitive|MD_StringMatchFlag_SlashInsensitive|
+              MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments);
+    if(!(flags & MD_NodeMatchFlag_Tags))
+    {
+        flags &= ~MD_NodeMatchFlag_TagArguments;
+    }
+    MD_b32 cached = (!MD_NodeIsNil(node) && node->structural_hash_key == flags + 1);
+    return _MD_StructuralHash(node, flags, !cached && !_MD_NodeIsReadOnly(node));
+}
+
+MD_FUNCTION_IMPL MD_b32
+MD_NodeMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags)
+{
+    MD_b32 result = 0;
+    if(a->kind == b->kind && MD_S8Match(a->string, b->string, flags))
+    {
+        result = 1;
+        if(a->kind != MD_NodeKind_Tag && (flags & MD_NodeMatchFlag_Tags))
+        {
+            for(MD_Node *a_tag = a->first_tag, *b_tag = b->first_tag;
+                !MD_NodeIsNil(a_tag) || !MD_NodeIsNil(b_tag);
+                a_tag = a_tag->next, b_tag = b_tag->next)
+            {
+                if(MD_NodeMatch(a_tag, b_tag, flags))
                 {
-                    MD_String8List bytes = {0};
-                    for(int i_byte = 0; i_byte < bad_token.raw_string.size; ++i_byte)
+                    if(flags & MD_NodeMatchFlag_TagArguments)
                     {
-                        MD_u8 b = bad_token.raw_string.str[i_byte];
-                        MD_S8ListPush(&bytes, MD_CStyleHexStringFromU64(b, 1));
+                        for(MD_Node *a_tag_arg = a_tag->first_child, *b_tag_arg = b_tag->first_child;
+                            !MD_NodeIsNil(a_tag_arg) || !MD_NodeIsNil(b_tag_arg);
+                            a_tag_arg = a_tag_arg->next, b_tag_arg = b_tag_arg->next)
+                        {
+                            if(!MD_NodeDeepMatch(a_tag_arg, b_tag_arg, flags))
+                            {
+                                result = 0;
+                                goto end;
+                            }
+                        }
                     }
-                    
-                    MD_StringJoin join = MD_ZERO_STRUCT;
-                    join.mid = MD_S8Lit(" ");
-                    MD_String8 byte_string = MD_S8ListJoin(bytes, &join);
-                    
-                    // NOTE(rjf): @error Bad character
-                    MD_Message *error = MD_MakeTokenError(string, bad_token, MD_MessageKind_Error,
-                                                          MD_S8Fmt("Non-ASCII character \"%.*s\"", MD_S8VArg(byte_string)));
-                    MD_MessageListPush(&result.errors, error);
-                }break;
-                
-                case MD_TokenKind_BrokenComment:
-                {
-                    // NOTE(rjf): @error Broken Comments
-                    MD_Message *error = MD_MakeTokenError(string, bad_token, MD_MessageKind_Error,
-                                                          MD_S8Lit("Unterminated comment"));
-                    MD_MessageListPush(&result.errors, error);
-                }break;
-                
-                case MD_TokenKind_BrokenStringLiteral:
+                }
+                else
                 {
-                    // NOTE(rjf): @error Broken String Literals
-                    MD_Message *error = MD_MakeTokenError(string, bad_token, MD_MessageKind_Error,
-                                                          MD_S8Lit("Unterminated string literal"));
-                    MD_MessageListPush(&result.errors, error);
-                }break;
+                    result = 0;
+                    goto end;
+                }
             }
-            goto retry;
         }
     }
-    
-    end_parse:;
-    
-    //- rjf: parse comments after nodes.
-    MD_String8 next_comment = MD_ZERO_STRUCT;
+    end:;
+    return result;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_NodeDeepMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags)
+{
+    MD_b32 result = MD_NodeMatch(a, b, flags);
+    if(result)
     {
-        MD_Token comment_token = MD_ZERO_STRUCT;
-        for(;;)
+        for(MD_Node *a_child = MD_FirstChildFromNode(a), *b_child = MD_FirstChildFromNode(b);
+            !MD_NodeIsNil(a_child) || !MD_NodeIsNil(b_child);
+            a_child = a_child->next, b_child = b_child->next)
         {
-            MD_Token token = MD_TokenFromString(MD_S8Skip(string, off));
-            if(token.kind == MD_TokenKind_Comment)
-            {
-                comment_token = token;
-                off += token.raw_string.size;
-                break;
-            }
-            
-            else if(token.kind == MD_TokenKind_Newline)
-            {
-                break;
-            }
-            else if((token.kind & MD_TokenGroup_Whitespace) != 0)
-            {
-                off += token.raw_string.size;
-            }
-            else
+            if(!_MD_NodeDeepMatch(a_child, b_child, flags))
             {
-                break;
+                result = 0;
+                goto end;
             }
         }
-        next_comment = comment_token.string;
     }
-    
-    //- rjf: fill result
-    parsed_node->prev_comment = prev_comment;
-    parsed_node->next_comment = next_comment;
-    result.node = parsed_node;
-    if(!MD_NodeIsNil(result.node))
+    end:;
+    return result;
+}
+
+// NOTE: Trees with different hashes never match, so most unequal trees
+// are rejected without a walk once their hashes are cached. Equal hashes are
+// confirmed by a full comparison. Sloppy matches cannot be hashed.
+MD_FUNCTION_IMPL MD_b32
+MD_NodeDeepMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags)
+{
+    MD_b32 result = 0;
+    if((flags & MD_StringMatchFlag_RightSideSloppy) ||
+       MD_NodeStructuralHash(a, flags) == MD_NodeStructuralHash(b, flags))
     {
-        result.node->first_tag = tags_parse.node;
-        result.node->last_tag = tags_parse.last_node;
+        result = _MD_NodeDeepMatch(a, b, flags);
     }
-    result.last_node = parsed_node;
-    result.string_advance= off - offset;
-    
     return result;
 }
 
-MD_FUNCTION_IMPL MD_ParseResult
-MD_ParseWholeString(MD_String8 filename, MD_String8 contents)
+//- tree diffs
+
+// NOTE: Chained table from a 64-bit key to indices of one list of
+// children. Chains are kept in list order, and the entries that have been
+// matched are skipped.
+typedef struct _MD_DiffTable _MD_DiffTable;
+struct _MD_DiffTable
 {
-    MD_Node *root = MD_MakeNode(MD_NodeKind_File, filename, contents, 0);
-    MD_ParseResult result = MD_ParseNodeSet(contents, 0, root, MD_ParseSetRule_Global);
-    result.node = result.last_node = root;
-    for(MD_Message *error = result.errors.first; error != 0; error = error->next)
+    MD_u64 *keys;
+    MD_u64 *heads;
+    MD_u64 cap;
+    MD_u64 *next;
+};
+
+MD_PRIVATE_FUNCTION_IMPL _MD_DiffTable
+_MD_DiffTableMake(MD_u64 count)
+{
+    _MD_DiffTable table = MD_ZERO_STRUCT;
+    table.cap = 16;
+    for(; table.cap < count*2; table.cap *= 2);
+    table.keys = MD_PushArrayZero(MD_u64, table.cap);
+    table.heads = MD_PushArrayZero(MD_u64, table.cap);
+    table.next = MD_PushArrayZero(MD_u64, count);
+    return table;
+}
+
+// NOTE: Entries must be inserted in reverse list order. Indices are
+// stored plus one, so that zero means none.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_DiffTableInsert(_MD_DiffTable *table, MD_u64 key, MD_u64 i)
+{
+    MD_u64 slot = key & (table->cap - 1);
+    for(; table->heads[slot] != 0 && table->keys[slot] != key; slot = (slot + 1) & (table->cap - 1));
+    table->keys[slot] = key;
+    table->next[i] = table->heads[slot];
+    table->heads[slot] = i + 1;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_u64 *
+_MD_DiffTableChainFromKey(_MD_DiffTable *table, MD_u64 key)
+{
+    MD_u64 *result = 0;
+    MD_u64 slot = key & (table->cap - 1);
+    for(; table->heads[slot] != 0; slot = (slot + 1) & (table->cap - 1))
     {
-        if(MD_NodeIsNil(error->node->parent))
+        if(table->keys[slot] == key)
         {
-            error->node->parent = root;
+            result = &table->heads[slot];
+            break;
         }
     }
     return result;
 }
 
-MD_FUNCTION_IMPL MD_ParseResult
-MD_ParseWholeFile(MD_String8 filename)
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_PushTreeEdit(MD_TreeEditList *edits, MD_TreeEditKind kind, MD_Node *old_node, MD_Node *new_node)
 {
-    MD_String8 file_contents = MD_LoadEntireFile(filename);
-    MD_ParseResult parse = MD_ParseWholeString(filename, file_contents);
-    if(file_contents.str == 0)
+    MD_TreeEdit *edit = MD_PushArrayZero(MD_TreeEdit, 1);
+    edit->kind = kind;
+    edit->old_node = old_node;
+    edit->new_node = new_node;
+    MD_QueuePush(edits->first, edits->last, edit);
+    edits->node_count += 1;
+}
+
+MD_PRIVATE_FUNCTION_IMPL MD_Node **
+_MD_ChildArrayForDiff(MD_Node *parent, MD_u64 *count_out)
+{
+    MD_u64 count = 0;
+    for(MD_EachNode(child, MD_FirstChildFromNode(parent)))
     {
-        // NOTE(rjf): @error File failing to load
-        MD_Message *error = MD_MakeNodeError(parse.node, MD_MessageKind_CatastrophicError,
-                                             MD_S8Fmt("Could not read file \"%.*s\"", MD_S8VArg(filename)));
-        MD_MessageListPush(&parse.errors, error);
+        count += 1;
     }
-    return parse;
+    MD_Node **children = MD_PushArray(MD_Node *, count + 1);
+    MD_u64 i = 0;
+    for(MD_EachNode(child, parent->first_child))
+    {
+        children[i] = child;
+        i += 1;
+    }
+    *count_out = count;
+    return children;
 }
 
-//~ Location Conversions
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_DiffNameKey(MD_Node *node, MD_MatchFlags flags)
+{
+    return _MD_HashMix((MD_u64)node->kind, _MD_HashStrWithFlags(node->string, flags));
+}
 
-MD_FUNCTION_IMPL MD_CodeLoc
-MD_CodeLocFromFileOffset(MD_String8 filename, MD_u8 *base, MD_u64 offset)
+// NOTE: Pairs up the children of two nodes in three passes. First,
+// unchanged subtrees are paired by structural hash. Then, the rest are
+// paired by kind and string, as updates. Of the pairs, those in the longest
+// run that kept their relative order stay in place, and the others are
+// moves. Unpaired children are deletes and inserts.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_TreeDiffChildren(MD_TreeEditList *edits, MD_Node *old_parent, MD_Node *new_parent, MD_MatchFlags flags)
 {
-    MD_CodeLoc loc;
-    loc.filename = filename;
-    loc.line = 1;
-    loc.column = 1;
-    if(base != 0)
+    MD_u64 old_count = 0;
+    MD_u64 new_count = 0;
+    MD_Node **olds = _MD_ChildArrayForDiff(old_parent, &old_count);
+    MD_Node **news = _MD_ChildArrayForDiff(new_parent, &new_count);
+    MD_u64 *old_partners = MD_PushArrayZero(MD_u64, old_count + 1);
+    MD_u64 *new_partners = MD_PushArrayZero(MD_u64, new_count + 1);
+    MD_b32 *new_changed = MD_PushArrayZero(MD_b32, new_count + 1);
+    
+    //- pass 1: unchanged subtrees
+    _MD_DiffTable hash_table = _MD_DiffTableMake(old_count);
+    for(MD_u64 i = old_count; i > 0; i -= 1)
     {
-        MD_u8 *at = base + offset;
-        for(MD_u64 i = 0; base+i < at && base[i]; i += 1)
+        _MD_DiffTableInsert(&hash_table, MD_NodeStructuralHash(olds[i-1], flags), i-1);
+    }
+    for(MD_u64 i = 0; i < new_count; i += 1)
+    {
+        MD_u64 *chain = _MD_DiffTableChainFromKey(&hash_table, MD_NodeStructuralHash(news[i], flags));
+        if(chain != 0)
         {
-            if(base[i] == '\n')
+            for(; *chain != 0 && old_partners[*chain - 1] != 0; *chain = hash_table.next[*chain - 1]);
+            for(MD_u64 old_i = *chain; old_i != 0; old_i = hash_table.next[old_i - 1])
             {
-                loc.line += 1;
-                loc.column = 1;
+                if(old_partners[old_i - 1] == 0 && _MD_NodeDeepMatch(olds[old_i - 1], news[i], flags))
+                {
+                    old_partners[old_i - 1] = i + 1;
+                    new_partners[i] = old_i;
+                    break;
+                }
             }
-            else
+        }
+    }
+    
+    //- pass 2: changed subtrees, by kind and string
+    _MD_DiffTable name_table = _MD_DiffTableMake(old_count);
+    for(MD_u64 i = old_count; i > 0; i -= 1)
+    {
+        if(old_partners[i-1] == 0)
+        {
+            _MD_DiffTableInsert(&name_table, _MD_DiffNameKey(olds[i-1], flags), i-1);
+        }
+    }
+    for(MD_u64 i = 0; i < new_count; i += 1)
+    {
+        MD_u64 *chain = (new_partners[i] == 0 ?
+                         _MD_DiffTableChainFromKey(&name_table, _MD_DiffNameKey(news[i], flags)) : 0);
+        if(chain != 0)
+        {
+            for(; *chain != 0 && old_partners[*chain - 1] != 0; *chain = name_table.next[*chain - 1]);
+            for(MD_u64 old_i = *chain; old_i != 0; old_i = name_table.next[old_i - 1])
             {
-                loc.column += 1;
+                MD_Node *old_node = olds[old_i - 1];
+                if(old_partners[old_i - 1] == 0 && old_node->kind == news[i]->kind &&
+                   MD_S8Match(old_node->string, news[i]->string, flags))
+                {
+                    old_partners[old_i - 1] = i + 1;
+                    new_partners[i] = old_i;
+                    new_changed[i] = 1;
+                    break;
+                }
+            }
+        }
+    }
+    
+    //- pass 3: longest increasing run of old positions, in new order
+    MD_u64 *tails = MD_PushArray(MD_u64, new_count + 1);
+    MD_u64 *prevs = MD_PushArray(MD_u64, new_count + 1);
+    MD_b32 *in_place = MD_PushArrayZero(MD_b32, new_count + 1);
+    MD_u64 run_length = 0;
+    for(MD_u64 i = 0; i < new_count; i += 1)
+    {
+        if(new_partners[i] != 0)
+        {
+            MD_u64 lo = 0;
+            MD_u64 hi = run_length;
+            for(; lo < hi;)
+            {
+                MD_u64 mid = lo + (hi - lo)/2;
+                if(new_partners[tails[mid]] < new_partners[i]) { lo = mid + 1; }
+                else { hi = mid; }
+            }
+            prevs[i] = (lo > 0) ? tails[lo - 1] + 1 : 0;
+            tails[lo] = i;
+            if(lo == run_length)
+            {
+                run_length += 1;
             }
         }
     }
-    return loc;
+    for(MD_u64 i = run_length ? tails[run_length - 1] + 1 : 0; i != 0; i = prevs[i - 1])
+    {
+        in_place[i - 1] = 1;
+    }
+    
+    //- emit edits
+    for(MD_u64 i = 0; i < old_count; i += 1)
+    {
+        if(old_partners[i] == 0)
+        {
+            _MD_PushTreeEdit(edits, MD_TreeEditKind_Delete, olds[i], MD_NilNode());
+        }
+    }
+    for(MD_u64 i = 0; i < new_count; i += 1)
+    {
+        if(new_partners[i] == 0)
+        {
+            _MD_PushTreeEdit(edits, MD_TreeEditKind_Insert, MD_NilNode(), news[i]);
+            continue;
+        }
+        MD_Node *old_node = olds[new_partners[i] - 1];
+        if(!in_place[i])
+        {
+            _MD_PushTreeEdit(edits, MD_TreeEditKind_Move, old_node, news[i]);
+        }
+        if(new_changed[i])
+        {
+            _MD_PushTreeEdit(edits, MD_TreeEditKind_Update, old_node, news[i]);
+            _MD_TreeDiffChildren(edits, old_node, news[i], flags);
+        }
+    }
 }
 
-MD_FUNCTION_IMPL MD_CodeLoc
-MD_CodeLocFromNode(MD_Node *node)
-{
-    MD_Node *root = MD_RootFromNode(node);
-    MD_CodeLoc loc = MD_CodeLocFromFileOffset(root->string, root->raw_string.str, node->offset);
-    return loc;
-}
-
-//~ Tree/List Building
-
-MD_FUNCTION_IMPL MD_b32
-MD_NodeIsNil(MD_Node *node)
+MD_FUNCTION_IMPL MD_TreeEditList
+MD_TreeDiff(MD_Node *old_root, MD_Node *new_root, MD_MatchFlags flags)
 {
-    return node == 0 || node == &_md_nil_node || node->kind == MD_NodeKind_Nil;
+    MD_TreeEditList edits = MD_ZERO_STRUCT;
+    flags &= ~MD_StringMatchFlag_RightSideSloppy;
+    _MD_TreeDiffChildren(&edits, old_root, new_root, flags);
+    return edits;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_NilNode(void) { return &_md_nil_node; }
-
-MD_FUNCTION_IMPL MD_Node *
-MD_MakeNode(MD_NodeKind kind, MD_String8 string, MD_String8 raw_string, MD_u64 offset)
-{
-    MD_Node *node = MD_PushArray(MD_Node, 1);
-    node->kind = kind;
-    node->string = string;
-    node->raw_string = raw_string;
-    node->next = node->prev = node->parent =
-        node->first_child = node->last_child =
-        node->first_tag = node->last_tag = node->ref_target = MD_NilNode();
-    node->offset = offset;
-    return node;
-}
+//~ Generation
 
 MD_FUNCTION_IMPL void
-MD_PushChild(MD_Node *parent, MD_Node *new_child)
+MD_DebugOutputTree(FILE *file, MD_Node *node, int indent_spaces)
 {
-    if (!MD_NodeIsNil(new_child))
+#define MD_PrintIndent() do { for(int i = 0; i < indent_spaces; i += 1) fprintf(file, " "); } while(0)
+    MD_FirstChildFromNode(node);
+    for(MD_Node *tag = node->first_tag; !MD_NodeIsNil(tag); tag = tag->next)
     {
-        MD_NodeDblPushBack(parent->first_child, parent->last_child, new_child);
-        new_child->parent = parent;
+        MD_PrintIndent();
+        fprintf(file, "@%.*s", MD_S8VArg(tag->string));
+        if(!MD_NodeIsNil(tag->first_child))
+        {
+            fprintf(file, "(");
+            for(MD_Node *child = tag->first_child; !MD_NodeIsNil(child); child = child->next)
+            {
+                MD_DebugOutputTree(file, child, 0);
+                fprintf(file, ", ");
+            }
+            fprintf(file, ")\n");
+        }
+        else if(!MD_NodeIsNil(tag->next))
+        {
+            fprintf(file, " ");
+        }
     }
-}
-
-MD_FUNCTION_IMPL void
-MD_PushTag(MD_Node *node, MD_Node *tag)
-{
-    if (!MD_NodeIsNil(tag))
+    if(!MD_NodeIsNil(node->first_tag))
     {
-        MD_NodeDblPushBack(node->first_tag, node->last_tag, tag);
-        tag->parent = node;
+        fprintf(file, "\n");
+    }
+    
+    if(node->raw_string.size > 0)
+    {
+        MD_PrintIndent();
+        fprintf(file, "%.*s", MD_S8VArg(node->raw_string));
+    }
+    
+    if(!MD_NodeIsNil(node->first_child))
+    {
+        if(node->raw_string.size > 0)
+        {
+            fprintf(file, ":\n");
+        }
+        MD_PrintIndent();
+        fprintf(file, "{\n");
+        for(MD_Node *child = node->first_child; !MD_NodeIsNil(child); child = child->next)
+        {
+            MD_DebugOutputTree(file, child, indent_spaces+2);
+        }
+        MD_PrintIndent();
+        fprintf(file, "}\n");
+    }
+    else
+    {
+        fprintf(file, "\n");
     }
+#undef MD_PrintIndent
 }
 
-MD_FUNCTION_IMPL MD_Node*
-MD_MakeList(void)
-{
-    MD_String8 empty = {0};
-    MD_Node *result = MD_MakeNode(MD_NodeKind_List, empty, empty, 0);
-    return(result);
-}
+//~ Command Line Argument Helper
 
-MD_FUNCTION_IMPL MD_Node*
-MD_PushNewReference(MD_Node *list, MD_Node *target)
+MD_FUNCTION MD_String8List
+MD_StringListFromArgCV(int argument_count, char **arguments)
 {
-    MD_Node *n = MD_MakeNode(MD_NodeKind_Reference, target->string, target->raw_string, target->offset);
-    n->ref_target = target;
-    MD_PushChild(list, n);
-    return(n);
+    MD_String8List options = MD_ZERO_STRUCT;
+    for(int i = 1; i < argument_count; i += 1)
+    {
+        MD_S8ListPush(&options, MD_S8CString(arguments[i]));
+    }
+    return options;
 }
 
-//~ Introspection Helpers
-
-MD_FUNCTION_IMPL MD_Node *
-MD_NodeFromString(MD_Node *first, MD_Node *one_past_last, MD_String8 string, MD_MatchFlags flags)
+MD_FUNCTION MD_CmdLine
+MD_MakeCmdLineFromOptions(MD_String8List options)
 {
-    MD_Node *result = MD_NilNode();
-    for(MD_Node *node = first; !MD_NodeIsNil(node) && node != one_past_last; node = node->next)
+    MD_CmdLine cmdln = MD_ZERO_STRUCT;
+    
+    for(MD_String8Node *n = options.first, *next = 0;
+        n; n = next)
     {
-        if(MD_S8Match(string, node->string, flags))
+        next = n->next;
+        
+        //- rjf: figure out whether or not this is an option by checking for `-` or `--`
+        // from the beginning of the string
+        MD_String8 option_name = MD_ZERO_STRUCT;
+        if(MD_S8Match(MD_S8Prefix(n->string, 2), MD_S8Lit("--"), 0))
         {
-            result = node;
-            break;
+            option_name = MD_S8Skip(n->string, 2);
+        }
+        else if(MD_S8Match(MD_S8Prefix(n->string, 1), MD_S8Lit("-"), 0))
+        {
+            option_name = MD_S8Skip(n->string, 1);
+        }
+        //- rjf: trim off anything after a `:` or `=`, use that as the first value string
+        MD_String8 first_value = MD_ZERO_STRUCT;
+        MD_b32 has_many_values = 0;
+        if(option_name.size != 0)
+        {
+            MD_u64 colon_signifier_pos = MD_S8FindSubstring(option_name, MD_S8Lit(":"), 0, 0);
+            MD_u64 equal_signifier_pos = MD_S8FindSubstring(option_name, MD_S8Lit("="), 0, 0);
+            MD_u64 signifier_pos = colon_signifier_pos > equal_signifier_pos ? equal_signifier_pos : colon_signifier_pos;
+            if(signifier_pos < option_name.size)
+            {
+                first_value = MD_S8Skip(option_name, signifier_pos+1);
+                option_name = MD_S8Prefix(option_name, signifier_pos);
+                if(MD_S8Match(MD_S8Suffix(first_value, 1), MD_S8Lit(","), 0))
+                {
+                    has_many_values = 1;
+                }
+            }
+        }
+        
+        //- rjf: gather arguments
+        if(option_name.size != 0)
+        {
+            MD_String8List option_values = MD_ZERO_STRUCT;
+            
+            //- rjf: push first value
+            if(first_value.size != 0)
+            {
+                MD_S8ListPush(&option_values, first_value);
+            }
+            
+            //- rjf: scan next string values, add them to option values until we hit a lack
+            // of a ',' between values
+            if(has_many_values)
+            {
+                for(MD_String8Node *v = next; v; v = v->next, next = v)
+                {
+                    MD_String8 value_str = v->string;
+                    MD_b32 next_has_arguments = MD_S8Match(MD_S8Suffix(value_str, 1), MD_S8Lit(","), 0);
+                    MD_b32 in_quotes = 0;
+                    MD_u64 start = 0;
+                    for(MD_u64 i = 0; i <= value_str.size; i += 1)
+                    {
+                        if(i == value_str.size || (value_str.str[i] == ',' && in_quotes == 0))
+                        {
+                            if(start != i)
+                            {
+                                MD_S8ListPush(&option_values, MD_S8Substring(value_str, start, i));
+                            }
+                            start = i+1;
+                        }
+                        else if(value_str.str[i] == '"')
+                        {
+                            in_quotes = !in_quotes;
+                        }
+                    }
+                    if(next_has_arguments == 0)
+                    {
+                        break;
+                    }
+                }
+            }
+            
+            //- rjf: insert the fully parsed option
+            {
+                MD_CmdLineOption *opt = MD_PushArray(MD_CmdLineOption, 1);
+                MD_MemoryZero(opt, sizeof(*opt));
+                opt->name = option_name;
+                opt->values = option_values;
+                if(cmdln.last_option == 0)
+                {
+                    cmdln.first_option = cmdln.last_option = opt;
+                }
+                else
+                {
+                    cmdln.last_option->next = opt;
+                    cmdln.last_option = cmdln.last_option->next;
+                }
+            }
+        }
+        
+        //- rjf: this argument is not an option, push it to regular inputs list.
+        else
+        {
+            MD_S8ListPush(&cmdln.inputs, n->string);
         }
     }
-    return result;
+    
+    return cmdln;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_NodeFromIndex(MD_Node *first, MD_Node *one_past_last, int n)
+MD_FUNCTION MD_String8List
+MD_CmdLineValuesFromString(MD_CmdLine cmdln, MD_String8 name)
 {
-    MD_Node *result = MD_NilNode();
-    if(n >= 0)
+    MD_String8List values = MD_ZERO_STRUCT;
+    for(MD_CmdLineOption *opt = cmdln.first_option; opt; opt = opt->next)
     {
-        int idx = 0;
-        for(MD_Node *node = first; !MD_NodeIsNil(node) && node != one_past_last; node = node->next, idx += 1)
+        if(MD_S8Match(opt->name, name, 0))
         {
-            if(idx == n)
-            {
-                result = node;
-                break;
-            }
+            values = opt->values;
+            break;
         }
     }
-    return result;
+    return values;
 }
-
-MD_FUNCTION_IMPL MD_Node *
-MD_NodeFromFlags(MD_Node *first, MD_Node *one_past_last, MD_NodeFlags flags)
+
+MD_FUNCTION MD_b32
+MD_CmdLineB32FromString(MD_CmdLine cmdln, MD_String8 name)
 {
-    MD_Node *result = MD_NilNode();
-    for(MD_Node *n = first; n != one_past_last && !MD_NodeIsNil(n); n = n->next)
+    MD_b32 result = 0;
+    for(MD_CmdLineOption *opt = cmdln.first_option; opt; opt = opt->next)
     {
-        if(n->flags & flags)
+        if(MD_S8Match(opt->name, name, 0))
         {
-            result = n;
+            result = 1;
             break;
         }
     }
     return result;
 }
 
-MD_FUNCTION_IMPL int
-MD_IndexFromNode(MD_Node *node)
+MD_FUNCTION MD_i64
+MD_CmdLineI64FromString(MD_CmdLine cmdln, MD_String8 name)
 {
-    int idx = 0;
-    for(MD_Node *last = node->prev; !MD_NodeIsNil(last); last = last->prev, idx += 1);
-    return idx;
+    MD_i64 v = 0;
+    MD_String8List values = MD_CmdLineValuesFromString(cmdln, name);
+    MD_String8 value_str = MD_S8ListJoin(values, 0);
+    v = MD_CStyleIntFromString(value_str);
+    return v;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_RootFromNode(MD_Node *node)
+//~ File System
+
+MD_FUNCTION_IMPL MD_String8
+MD_LoadEntireFile(MD_String8 filename)
 {
-    MD_Node *parent = node;
-    for(MD_Node *p = parent; !MD_NodeIsNil(p); p = p->parent)
+    MD_String8 file_contents = MD_ZERO_STRUCT;
+    FILE *file = fopen((char*)MD_S8Copy(filename).str, "rb");
+    if(file)
     {
-        parent = p;
+        fseek(file, 0, SEEK_END);
+        MD_u64 file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        file_contents.str = MD_PushArray(MD_u8, file_size+1);
+        if(file_contents.str)
+        {
+            file_contents.size = file_size;
+            fread(file_contents.str, 1, file_size, file);
+        }
+        fclose(file);
     }
-    return parent;
-}
-
-MD_FUNCTION_IMPL MD_Node *
-MD_ChildFromString(MD_Node *node, MD_String8 child_string, MD_MatchFlags flags)
-{
-    return MD_NodeFromString(node->first_child, MD_NilNode(), child_string, flags);
+    return file_contents;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_TagFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags)
+MD_FUNCTION_IMPL MD_String8
+MD_MapEntireFile(MD_String8 filename)
 {
-    return MD_NodeFromString(node->first_tag, MD_NilNode(), tag_string, flags);
+    MD_String8 file_contents = MD_ZERO_STRUCT;
+#if defined(MD_IMPL_MapEntireFile)
+    file_contents = MD_IMPL_MapEntireFile(filename);
+#endif
+    if(file_contents.str == 0)
+    {
+        file_contents = MD_LoadEntireFile(filename);
+    }
+    return file_contents;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_ChildFromIndex(MD_Node *node, int n)
+MD_FUNCTION_IMPL MD_b32
+MD_WriteEntireFile(MD_String8 filename, MD_String8 data)
 {
-    return MD_NodeFromIndex(node->first_child, MD_NilNode(), n);
+    MD_b32 result = 0;
+    FILE *file = fopen((char*)MD_S8Copy(filename).str, "wb");
+    if(file)
+    {
+        result = (fwrite(data.str, 1, data.size, file) == data.size);
+        if(fclose(file) != 0)
+        {
+            result = 0;
+        }
+    }
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_TagFromIndex(MD_Node *node, int n)
+MD_FUNCTION_IMPL MD_b32
+MD_FileIterIncrement(MD_FileIter *it, MD_String8 path, MD_FileInfo *out_info)
 {
-    return MD_NodeFromIndex(node->first_child, MD_NilNode(), n);
+#if !defined(MD_IMPL_FileIterIncrement)
+    return(0);
+#else
+    return(MD_IMPL_FileIterIncrement(it, path, out_info));
+#endif
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_TagArgFromIndex(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags, int n)
+//~ Binary Trees
+
+// NOTE: A binary tree is laid out as follows, in the endianness and
+// pointer size of the machine that wrote it:
+//
+//   _MD_BinaryHeader
+//   MD_Node    nodes[node_count]       - preorder, tags before children; root first
+//   MD_Message messages[message_count]
+//   MD_u8      blob[blob_size]         - the root's raw_string, then other strings
+//
+// Node and message pointers are stored as (index+1), with 0 meaning nil, and
+// string pointers as (blob offset+1), with 0 meaning null. Loading is a single
+// in-place relocation pass over the nodes and messages.
+
+#define _MD_BINARY_MAGIC   0x4E49424B5345444DULL
+#define _MD_BINARY_VERSION 2
+
+typedef struct _MD_BinaryHeader _MD_BinaryHeader;
+struct _MD_BinaryHeader
 {
-    MD_Node *tag = MD_TagFromString(node, tag_string, flags);
-    return MD_ChildFromIndex(tag, n);
-}
+    MD_u64 magic;
+    MD_u32 version;
+    MD_u32 pointer_size;
+    MD_u32 node_size;
+    MD_u32 message_size;
+    MD_u64 node_count;
+    MD_u64 message_count;
+    MD_u64 blob_size;
+    MD_u64 source_size;
+};
 
-MD_FUNCTION_IMPL MD_Node *
-MD_TagArgFromString(MD_Node *node, MD_String8 tag_string, MD_MatchFlags tag_str_flags, MD_String8 arg_string, MD_MatchFlags arg_str_flags)
+typedef struct _MD_BinaryWriter _MD_BinaryWriter;
+struct _MD_BinaryWriter
 {
-    MD_Node *tag = MD_TagFromString(node, tag_string, tag_str_flags);
-    MD_Node *arg = MD_ChildFromString(tag, arg_string, arg_str_flags);
-    return arg;
-}
+    MD_Map node_indices;
+    MD_Node **nodes;
+    MD_u64 node_count;
+    MD_String8 source;
+    MD_String8List extra_strings;
+    MD_u64 blob_size;
+};
 
-MD_FUNCTION_IMPL MD_b32
-MD_NodeHasTag(MD_Node *node, MD_String8 tag_string, MD_MatchFlags flags)
+typedef struct _MD_BinaryReader _MD_BinaryReader;
+struct _MD_BinaryReader
 {
-    return !MD_NodeIsNil(MD_TagFromString(node, tag_string, flags));
-}
+    MD_Node *nodes;
+    MD_u64 node_count;
+    MD_u8 *blob;
+    MD_u64 blob_size;
+    MD_b32 good;
+};
 
-MD_FUNCTION_IMPL MD_i64
-MD_ChildCountFromNode(MD_Node *node)
+MD_PRIVATE_FUNCTION_IMPL MD_u64
+_MD_BinaryCountTree(MD_Node *node, MD_MessageList *errors)
 {
-    MD_i64 result = 0;
-    for(MD_EachNode(child, node->first_child))
+    MD_u64 count = 1;
+    if(node->unexpanded != 0)
     {
-        result += 1;
+        MD_ParseResult expand = MD_ExpandNode(node);
+        MD_MessageListConcat(errors, &expand.errors);
     }
-    return result;
-}
-
-MD_FUNCTION_IMPL MD_i64
-MD_TagCountFromNode(MD_Node *node)
-{
-    MD_i64 result = 0;
-    for(MD_EachNode(tag, node->first_tag))
+    for(MD_Node *tag = node->first_tag; !MD_NodeIsNil(tag); tag = tag->next)
     {
-        result += 1;
+        count += _MD_BinaryCountTree(tag, errors);
     }
-    return result;
+    for(MD_Node *child = node->first_child; !MD_NodeIsNil(child); child = child->next)
+    {
+        count += _MD_BinaryCountTree(child, errors);
+    }
+    return count;
 }
 
-MD_FUNCTION_IMPL MD_Node *
-MD_NodeFromReference(MD_Node *node)
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_BinaryGatherNode(_MD_BinaryWriter *w, MD_Node *node)
 {
-    MD_Node *result = node;
-    while(result->kind == MD_NodeKind_Reference)
+    MD_MapKey key = MD_MapKeyPtr(node);
+    if(MD_MapLookup(&w->node_indices, key) == 0)
     {
-        result = result->ref_target;
+        w->nodes[w->node_count] = node;
+        w->node_count += 1;
+        MD_MapInsert(&w->node_indices, key, (void *)(size_t)w->node_count);
     }
-    return result;
 }
 
-//~ Error/Warning Helpers
-
-MD_FUNCTION_IMPL void
-MD_PrintMessage(FILE *out, MD_CodeLoc loc, MD_MessageKind kind, MD_String8 str)
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_BinaryGatherTree(_MD_BinaryWriter *w, MD_Node *node)
 {
-    const char *kind_name = "";
-    switch (kind){
-        default: break;
-        case MD_MessageKind_Note: kind_name = "note: "; break;
-        case MD_MessageKind_Warning: kind_name = "warning: "; break;
-        case MD_MessageKind_Error: kind_name = "error: "; break;
-        case MD_MessageKind_CatastrophicError: kind_name = "fatal error: "; break;
+    _MD_BinaryGatherNode(w, node);
+    for(MD_Node *tag = node->first_tag; !MD_NodeIsNil(tag); tag = tag->next)
+    {
+        _MD_BinaryGatherTree(w, tag);
+    }
+    for(MD_Node *child = node->first_child; !MD_NodeIsNil(child); child = child->next)
+    {
+        _MD_BinaryGatherTree(w, child);
     }
-    fprintf(out, "%.*s:%i:%i: %s%.*s\n",
-            MD_S8VArg(loc.filename), loc.line, loc.column,
-            kind_name, MD_S8VArg(str));
 }
 
-MD_FUNCTION_IMPL void
-MD_PrintMessageFmt(FILE *out, MD_CodeLoc loc, MD_MessageKind kind, char *fmt, ...)
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_BinaryEncodeNode(_MD_BinaryWriter *w, MD_Node *node)
 {
-    // TODO(allen): use scratch
-    va_list args;
-    va_start(args, fmt);
-    MD_PrintMessage(out, loc, kind, MD_S8FmtV(fmt, args));
-    va_end(args);
+    size_t encoded = 0;
+    if(!MD_NodeIsNil(node))
+    {
+        MD_MapSlot *slot = MD_MapLookup(&w->node_indices, MD_MapKeyPtr(node));
+        if(slot != 0)
+        {
+            encoded = (size_t)slot->val;
+        }
+    }
+    return (MD_Node *)encoded;
 }
 
-MD_FUNCTION_IMPL void
-MD_PrintNodeMessage(FILE *out, MD_Node *node, MD_MessageKind kind, MD_String8 str)
+MD_PRIVATE_FUNCTION_IMPL MD_String8
+_MD_BinaryEncodeString(_MD_BinaryWriter *w, MD_String8 string)
 {
-    MD_CodeLoc loc = MD_CodeLocFromNode(node);
-    MD_PrintMessage(out, loc, kind, str);
+    MD_String8 result = string;
+    if(string.str != 0)
+    {
+        MD_u64 offset = 0;
+        if(w->source.str <= string.str && string.str + string.size <= w->source.str + w->source.size)
+        {
+            offset = (MD_u64)(string.str - w->source.str);
+        }
+        else
+        {
+            offset = w->blob_size;
+            MD_S8ListPush(&w->extra_strings, string);
+            w->blob_size += string.size;
+        }
+        result.str = (MD_u8 *)(size_t)(offset + 1);
+    }
+    return result;
 }
 
-MD_FUNCTION_IMPL void
-MD_PrintNodeMessageFmt(FILE *out, MD_Node *node, MD_MessageKind kind, char *fmt, ...)
+MD_PRIVATE_FUNCTION_IMPL MD_Node *
+_MD_BinaryDecodeNode(_MD_BinaryReader *r, MD_Node *encoded)
 {
-    // TODO(allen): use scratch
-    va_list args;
-    va_start(args, fmt);
-    MD_PrintNodeMessage(out, node, kind, MD_S8FmtV(fmt, args));
-    va_end(args);
+    MD_Node *result = MD_NilNode();
+    MD_u64 index = (MD_u64)(size_t)encoded;
+    if(index > r->node_count)
+    {
+        r->good = 0;
+    }
+    else if(index != 0)
+    {
+        result = &r->nodes[index-1];
+    }
+    return result;
 }
 
-//~ Tree Comparison/Verification
-
-MD_FUNCTION_IMPL MD_b32
-MD_NodeMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags)
+MD_PRIVATE_FUNCTION_IMPL MD_String8
+_MD_BinaryDecodeString(_MD_BinaryReader *r, MD_String8 encoded)
 {
-    MD_b32 result = 0;
-    if(a->kind == b->kind && MD_S8Match(a->string, b->string, flags))
+    MD_String8 result = encoded;
+    if(encoded.str != 0)
     {
-        result = 1;
-        if(a->kind != MD_NodeKind_Tag && (flags & MD_NodeMatchFlag_Tags))
+        MD_u64 offset = (MD_u64)(size_t)encoded.str - 1;
+        if(offset > r->blob_size || encoded.size > r->blob_size - offset)
         {
-            for(MD_Node *a_tag = a->first_tag, *b_tag = b->first_tag;
-                !MD_NodeIsNil(a_tag) || !MD_NodeIsNil(b_tag);
-                a_tag = a_tag->next, b_tag = b_tag->next)
-            {
-                if(MD_NodeMatch(a_tag, b_tag, flags))
-                {
-                    if(flags & MD_NodeMatchFlag_TagArguments)
-                    {
-                        for(MD_Node *a_tag_arg = a_tag->first_child, *b_tag_arg = b_tag->first_child;
-                            !MD_NodeIsNil(a_tag_arg) || !MD_NodeIsNil(b_tag_arg);
-                            a_tag_arg = a_tag_arg->next, b_tag_arg = b_tag_arg->next)
-                        {
-                            if(!MD_NodeDeepMatch(a_tag_arg, b_tag_arg, flags))
-                            {
-                                result = 0;
-                                goto end;
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    result = 0;
-                    goto end;
-                }
-            }
+            r->good = 0;
+            result = MD_S8Lit("");
+        }
+        else
+        {
+            result.str = r->blob + offset;
         }
     }
-    end:;
     return result;
 }
 
-MD_FUNCTION_IMPL MD_b32
-MD_NodeDeepMatch(MD_Node *a, MD_Node *b, MD_MatchFlags flags)
+MD_FUNCTION_IMPL MD_String8
+MD_BinaryFromParseResult(MD_ParseResult parse)
 {
-    MD_b32 result = MD_NodeMatch(a, b, flags);
-    if(result)
+    MD_MessageList errors = parse.errors;
+    MD_Node *root = parse.node;
+    
+    //- expand lazily-parsed sets, so the binary holds the whole tree
+    MD_u64 tree_count = 0;
+    if(!MD_NodeIsNil(root))
     {
-        for(MD_Node *a_child = a->first_child, *b_child = b->first_child;
-            !MD_NodeIsNil(a_child) || !MD_NodeIsNil(b_child);
-            a_child = a_child->next, b_child = b_child->next)
+        tree_count = _MD_BinaryCountTree(root, &errors);
+    }
+    MD_u64 message_count = 0;
+    for(MD_Message *message = errors.first; message != 0; message = message->next)
+    {
+        message_count += 1;
+    }
+    
+    //- gather the tree in preorder, then any message nodes outside of it
+    _MD_BinaryWriter w = MD_ZERO_STRUCT;
+    w.node_indices = MD_MapMakeBucketCount(tree_count + message_count + 1);
+    w.nodes = MD_PushArray(MD_Node *, tree_count + message_count);
+    w.source = root->raw_string;
+    w.blob_size = w.source.size;
+    if(!MD_NodeIsNil(root))
+    {
+        _MD_BinaryGatherTree(&w, root);
+    }
+    for(MD_Message *message = errors.first; message != 0; message = message->next)
+    {
+        if(!MD_NodeIsNil(message->node))
         {
-            if(!MD_NodeDeepMatch(a_child, b_child, flags))
-            {
-                result = 0;
-                goto end;
-            }
+            _MD_BinaryGatherNode(&w, message->node);
         }
     }
-    end:;
-    return result;
-}
-
-//~ Generation
-
-MD_FUNCTION_IMPL void
-MD_DebugOutputTree(FILE *file, MD_Node *node, int indent_spaces)
-{
-#define MD_PrintIndent() do { for(int i = 0; i < indent_spaces; i += 1) fprintf(file, " "); } while(0)
-    for(MD_Node *tag = node->first_tag; !MD_NodeIsNil(tag); tag = tag->next)
+    
+    //- encode nodes
+    MD_Node *nodes = MD_PushArrayZero(MD_Node, w.node_count);
+    for(MD_u64 i = 0; i < w.node_count; i += 1)
     {
-        MD_PrintIndent();
-        fprintf(file, "@%.*s", MD_S8VArg(tag->string));
-        if(!MD_NodeIsNil(tag->first_child))
+        MD_Node *src = w.nodes[i];
+        MD_Node *dst = &nodes[i];
+        *dst = *src;
+        dst->next         = _MD_BinaryEncodeNode(&w, src->next);
+        dst->prev         = _MD_BinaryEncodeNode(&w, src->prev);
+        dst->parent       = _MD_BinaryEncodeNode(&w, src->parent);
+        dst->first_child  = _MD_BinaryEncodeNode(&w, src->first_child);
+        dst->last_child   = _MD_BinaryEncodeNode(&w, src->last_child);
+        dst->first_tag    = _MD_BinaryEncodeNode(&w, src->first_tag);
+        dst->last_tag     = _MD_BinaryEncodeNode(&w, src->last_tag);
+        dst->ref_target   = _MD_BinaryEncodeNode(&w, src->ref_target);
+        dst->string       = _MD_BinaryEncodeString(&w, src->string);
+        dst->raw_string   = _MD_BinaryEncodeString(&w, src->raw_string);
+        dst->prev_comment = _MD_BinaryEncodeString(&w, src->prev_comment);
+        dst->next_comment = _MD_BinaryEncodeString(&w, src->next_comment);
+        dst->id           = 0;
+        dst->structural_hash_key = 0;
+        dst->unexpanded   = 0;
+        dst->accel        = 0;
+    }
+    
+    //- encode messages
+    MD_Message *messages = MD_PushArrayZero(MD_Message, message_count);
+    {
+        MD_u64 i = 0;
+        for(MD_Message *message = errors.first; message != 0; message = message->next, i += 1)
         {
-            fprintf(file, "(");
-            for(MD_Node *child = tag->first_child; !MD_NodeIsNil(child); child = child->next)
-            {
-                MD_DebugOutputTree(file, child, 0);
-                fprintf(file, ", ");
-            }
-            fprintf(file, ")\n");
+            messages[i].next = (i+1 < message_count) ? (MD_Message *)(size_t)(i+2) : 0;
+            messages[i].node = _MD_BinaryEncodeNode(&w, message->node);
+            messages[i].kind = message->kind;
+            messages[i].string = _MD_BinaryEncodeString(&w, message->string);
         }
-        else if(!MD_NodeIsNil(tag->next))
+    }
+    
+    //- fill header
+    _MD_BinaryHeader *header = MD_PushArrayZero(_MD_BinaryHeader, 1);
+    header->magic         = _MD_BINARY_MAGIC;
+    header->version       = _MD_BINARY_VERSION;
+    header->pointer_size  = sizeof(void *);
+    header->node_size     = sizeof(MD_Node);
+    header->message_size  = sizeof(MD_Message);
+    header->node_count    = w.node_count;
+    header->message_count = message_count;
+    header->blob_size     = w.blob_size;
+    header->source_size   = w.source.size;
+    
+    //- join
+    MD_String8List parts = MD_ZERO_STRUCT;
+    MD_S8ListPush(&parts, MD_S8((MD_u8 *)header, sizeof(*header)));
+    MD_S8ListPush(&parts, MD_S8((MD_u8 *)nodes, sizeof(MD_Node)*w.node_count));
+    MD_S8ListPush(&parts, MD_S8((MD_u8 *)messages, sizeof(MD_Message)*message_count));
+    MD_S8ListPush(&parts, w.source);
+    MD_S8ListConcat(&parts, &w.extra_strings);
+    return MD_S8ListJoin(parts, 0);
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_ParseResultFromBinary(MD_String8 data)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    _MD_BinaryReader r = MD_ZERO_STRUCT;
+    _MD_BinaryHeader *header = (_MD_BinaryHeader *)data.str;
+    MD_Message *messages = 0;
+    MD_u64 message_count = 0;
+    MD_u64 source_size = 0;
+    
+    //- validate header & layout
+    if(data.size >= sizeof(_MD_BinaryHeader) && ((size_t)data.str & 7) == 0 &&
+       header->magic == _MD_BINARY_MAGIC &&
+       header->version == _MD_BINARY_VERSION &&
+       header->pointer_size == sizeof(void *) &&
+       header->node_size == sizeof(MD_Node) &&
+       header->message_size == sizeof(MD_Message) &&
+       header->node_count > 0 &&
+       header->node_count <= data.size / sizeof(MD_Node) &&
+       header->message_count <= data.size / sizeof(MD_Message) &&
+       header->source_size <= header->blob_size)
+    {
+        MD_u64 nodes_off = sizeof(_MD_BinaryHeader);
+        MD_u64 messages_off = nodes_off + header->node_count*sizeof(MD_Node);
+        MD_u64 blob_off = messages_off + header->message_count*sizeof(MD_Message);
+        if(blob_off <= data.size && header->blob_size <= data.size - blob_off)
         {
-            fprintf(file, " ");
+            r.nodes = (MD_Node *)(data.str + nodes_off);
+            r.node_count = header->node_count;
+            r.blob = data.str + blob_off;
+            r.blob_size = header->blob_size;
+            r.good = 1;
+            messages = (MD_Message *)(data.str + messages_off);
+            message_count = header->message_count;
+            source_size = header->source_size;
         }
     }
-    if(!MD_NodeIsNil(node->first_tag))
+    
+    //- relocate nodes
+    for(MD_u64 i = 0; r.good && i < r.node_count; i += 1)
     {
-        fprintf(file, "\n");
+        MD_Node *node = &r.nodes[i];
+        if(node->kind <= MD_NodeKind_Nil || node->kind >= MD_NodeKind_COUNT)
+        {
+            r.good = 0;
+        }
+        node->next         = _MD_BinaryDecodeNode(&r, node->next);
+        node->prev         = _MD_BinaryDecodeNode(&r, node->prev);
+        node->parent       = _MD_BinaryDecodeNode(&r, node->parent);
+        node->first_child  = _MD_BinaryDecodeNode(&r, node->first_child);
+        node->last_child   = _MD_BinaryDecodeNode(&r, node->last_child);
+        node->first_tag    = _MD_BinaryDecodeNode(&r, node->first_tag);
+        node->last_tag     = _MD_BinaryDecodeNode(&r, node->last_tag);
+        node->ref_target   = _MD_BinaryDecodeNode(&r, node->ref_target);
+        node->string       = _MD_BinaryDecodeString(&r, node->string);
+        node->raw_string   = _MD_BinaryDecodeString(&r, node->raw_string);
+        node->prev_comment = _MD_BinaryDecodeString(&r, node->prev_comment);
+        node->next_comment = _MD_BinaryDecodeString(&r, node->next_comment);
+        node->id           = _MD_MakeNodeId();
+        node->structural_hash_key = 0;
+        node->unexpanded   = 0;
+        node->accel        = 0;
     }
     
-    if(node->raw_string.size > 0)
+    //- relocate messages
+    for(MD_u64 i = 0; r.good && i < message_count; i += 1)
     {
-        MD_PrintIndent();
-        fprintf(file, "%.*s", MD_S8VArg(node->raw_string));
+        MD_Message *message = &messages[i];
+        message->node = _MD_BinaryDecodeNode(&r, message->node);
+        message->string = _MD_BinaryDecodeString(&r, message->string);
+        MD_MessageListPush(&result.errors, message);
     }
     
-    if(!MD_NodeIsNil(node->first_child))
+    if(r.good)
     {
-        if(node->raw_string.size > 0)
-        {
-            fprintf(file, ":\n");
-        }
-        MD_PrintIndent();
-        fprintf(file, "{\n");
-        for(MD_Node *child = node->first_child; !MD_NodeIsNil(child); child = child->next)
-        {
-            MD_DebugOutputTree(file, child, indent_spaces+2);
-        }
-        MD_PrintIndent();
-        fprintf(file, "}\n");
+        result.node = result.last_node = &r.nodes[0];
+        result.string_advance = source_size;
     }
     else
     {
-        fprintf(file, "\n");
+        // NOTE: @error Binary data failing to validate
+        result = MD_ParseResultZero();
+        MD_Message *error = MD_MakeNodeError(MD_NilNode(), MD_MessageKind_CatastrophicError,
+                                             MD_S8Lit("Invalid or incompatible binary tree data"));
+        MD_MessageListPush(&result.errors, error);
     }
-#undef MD_PrintIndent
+    return result;
 }
 
-//~ Command Line Argument Helper
-
-MD_FUNCTION MD_String8List
-MD_StringListFromArgCV(int argument_count, char **arguments)
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_BinaryMatchesSource(MD_String8 data, MD_String8 source)
 {
-    MD_String8List options = MD_ZERO_STRUCT;
-    for(int i = 1; i < argument_count; i += 1)
+    MD_b32 result = 0;
+    _MD_BinaryHeader *header = (_MD_BinaryHeader *)data.str;
+    if(data.size >= sizeof(_MD_BinaryHeader) &&
+       header->magic == _MD_BINARY_MAGIC &&
+       header->version == _MD_BINARY_VERSION &&
+       header->node_size == sizeof(MD_Node) &&
+       header->message_size == sizeof(MD_Message) &&
+       header->source_size == source.size &&
+       header->node_count <= data.size / sizeof(MD_Node) &&
+       header->message_count <= data.size / sizeof(MD_Message))
     {
-        MD_S8ListPush(&options, MD_S8CString(arguments[i]));
+        MD_u64 blob_off = (sizeof(_MD_BinaryHeader) +
+                           header->node_count*sizeof(MD_Node) +
+                           header->message_count*sizeof(MD_Message));
+        result = (blob_off <= data.size && source.size <= data.size - blob_off &&
+                  memcmp(data.str + blob_off, source.str, source.size) == 0);
     }
-    return options;
+    return result;
 }
 
-MD_FUNCTION MD_CmdLine
-MD_MakeCmdLineFromOptions(MD_String8List options)
+// NOTE: Cache entries are named by the hash of everything that decides
+// the tree, and are only used when the source stored in the entry matches the
+// file byte for byte, so a hash collision costs a parse rather than a wrong
+// tree. Entries are written to a unique temporary file and then renamed into
+// place, so concurrent processes never observe a partial entry. Since every
+// writer of an entry writes the same bytes, losing a rename race is harmless.
+//
+// A lazily parsed tree is fully expanded once loaded from the cache, so lazy
+// and eager parses share entries. Lazy parses only read them; writing one
+// would expand the whole tree that the parse was meant to defer.
+MD_PRIVATE_FUNCTION_IMPL MD_ParseResult
+_MD_ParseWholeFileWithCache(MD_String8 filename, MD_String8 contents, MD_ParseOptions *options)
 {
-    MD_CmdLine cmdln = MD_ZERO_STRUCT;
+    MD_ParseResult result = MD_ZERO_STRUCT;
+    MD_b32 hit = 0;
+    MD_String8 options_key = MD_S8Fmt("%x %llu %llu %llu %llu %llu", options->flags & ~MD_ParseFlag_LazySets,
+                                      options->max_depth, options->max_node_count,
+                                      options->max_byte_count, options->max_step_count,
+                                      options->max_error_count);
+    MD_String8 cache_path = MD_S8Fmt("%.*s/%016llx%016llx%08x.mdb", MD_S8VArg(options->cache_dir),
+                                     MD_HashStr(contents), MD_HashStr(filename),
+                                     (MD_u32)MD_HashStr(options_key));
     
-    for(MD_String8Node *n = options.first, *next = 0;
-        n; n = next)
+    //- try the cache
+    MD_String8 cached = MD_MapEntireFile(cache_path);
+    if(_MD_BinaryMatchesSource(cached, contents))
     {
-        next = n->next;
-        
-        //- rjf: figure out whether or not this is an option by checking for `-` or `--`
-        // from the beginning of the string
-        MD_String8 option_name = MD_ZERO_STRUCT;
-        if(MD_S8Match(MD_S8Prefix(n->string, 2), MD_S8Lit("--"), 0))
-        {
-            option_name = MD_S8Skip(n->string, 2);
-        }
-        else if(MD_S8Match(MD_S8Prefix(n->string, 1), MD_S8Lit("-"), 0))
+        result = MD_ParseResultFromBinary(cached);
+        hit = !MD_NodeIsNil(result.node);
+        if(hit && options->index != 0)
         {
-            option_name = MD_S8Skip(n->string, 1);
+            MD_IndexAddSubtree(options->index, result.node);
         }
-        //- rjf: trim off anything after a `:` or `=`, use that as the first value string
-        MD_String8 first_value = MD_ZERO_STRUCT;
-        MD_b32 has_many_values = 0;
-        if(option_name.size != 0)
+    }
+    
+    //- parse & fill the cache on a miss
+    if(!hit)
+    {
+        result = MD_ParseWholeStringWithOptions(filename, contents, options);
+    }
+    if(!hit && !(options->flags & MD_ParseFlag_LazySets))
+    {
+        MD_String8 binary = MD_BinaryFromParseResult(result);
+        static MD_u64 temp_counter = 0;
+        for(int attempt = 0; attempt < 16; attempt += 1)
         {
-            MD_u64 colon_signifier_pos = MD_S8FindSubstring(option_name, MD_S8Lit(":"), 0, 0);
-            MD_u64 equal_signifier_pos = MD_S8FindSubstring(option_name, MD_S8Lit("="), 0, 0);
-            MD_u64 signifier_pos = colon_signifier_pos > equal_signifier_pos ? equal_signifier_pos : colon_signifier_pos;
-            if(signifier_pos < option_name.size)
+            temp_counter += 1;
+            MD_String8 temp_path = MD_S8Fmt("%.*s.%016llx.tmp", MD_S8VArg(cache_path),
+                                            MD_HashPtr(binary.str) ^ temp_counter);
+            FILE *file = fopen((char *)temp_path.str, "wbx");
+            if(file)
             {
-                first_value = MD_S8Skip(option_name, signifier_pos+1);
-                option_name = MD_S8Prefix(option_name, signifier_pos);
-                if(MD_S8Match(MD_S8Suffix(first_value, 1), MD_S8Lit(","), 0))
+                MD_b32 written = (fwrite(binary.str, 1, binary.size, file) == binary.size);
+                written = (fclose(file) == 0) && written;
+                if(!written || rename((char *)temp_path.str, (char *)cache_path.str) != 0)
                 {
-                    has_many_values = 1;
+                    remove((char *)temp_path.str);
                 }
+                break;
             }
         }
-        
-        //- rjf: gather arguments
-        if(option_name.size != 0)
+    }
+    return result;
+}
+
+MD_FUNCTION_IMPL MD_ParseResult
+MD_LoadBinaryFile(MD_String8 filename)
+{
+    MD_ParseResult result = MD_ParseResultZero();
+    MD_String8 data = MD_MapEntireFile(filename);
+    if(data.str == 0)
+    {
+        // NOTE: @error File failing to load
+        MD_Message *error = MD_MakeNodeError(MD_NilNode(), MD_MessageKind_CatastrophicError,
+                                             MD_S8Fmt("Could not read file \"%.*s\"", MD_S8VArg(filename)));
+        MD_MessageListPush(&result.errors, error);
+    }
+    else
+    {
+        result = MD_ParseResultFromBinary(data);
+    }
+    return result;
+}
+
+//~ Hot Reload
+
+// NOTE: Readers publish the epoch they entered in, then load the current
+// version. The reloading thread swaps in a new version, then advances the
+// epoch; a replaced version is retired once every reader is either outside
+// of a read or entered after the swap, since such readers can only have
+// loaded the new version.
+
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_HotReloadRetire(MD_HotReload *reload)
+{
+    //- find the oldest epoch a reader may still be in
+    MD_u64 min_epoch = _MD_AtomicLoadU64(&reload->epoch);
+    for(MD_u64 i = 0; i < reload->reader_count; i += 1)
+    {
+        MD_u64 epoch = _MD_AtomicLoadU64(&reload->readers[i].epoch);
+        if(epoch != 0 && epoch < min_epoch)
         {
-            MD_String8List option_values = MD_ZERO_STRUCT;
-            
-            //- rjf: push first value
-            if(first_value.size != 0)
-            {
-                MD_S8ListPush(&option_values, first_value);
-            }
-            
-            //- rjf: scan next string values, add them to option values until we hit a lack
-            // of a ',' between values
-            if(has_many_values)
-            {
-                for(MD_String8Node *v = next; v; v = v->next, next = v)
-                {
-                    MD_String8 value_str = v->string;
-                    MD_b32 next_has_arguments = MD_S8Match(MD_S8Suffix(value_str, 1), MD_S8Lit(","), 0);
-                    MD_b32 in_quotes = 0;
-                    MD_u64 start = 0;
-                    for(MD_u64 i = 0; i <= value_str.size; i += 1)
-                    {
-                        if(i == value_str.size || (value_str.str[i] == ',' && in_quotes == 0))
-                        {
-                            if(start != i)
-                            {
-                                MD_S8ListPush(&option_values, MD_S8Substring(value_str, start, i));
-                            }
-                            start = i+1;
-                        }
-                        else if(value_str.str[i] == '"')
-                        {
-                            in_quotes = !in_quotes;
-                        }
-                    }
-                    if(next_has_arguments == 0)
-                    {
-                        break;
-                    }
-                }
-            }
-            
-            //- rjf: insert the fully parsed option
+            min_epoch = epoch;
+        }
+    }
+    
+    //- retire every version that was replaced before it
+    for(MD_HotReloadVersion **ptr = &reload->first_retired; *ptr != 0;)
+    {
+        MD_HotReloadVersion *version = *ptr;
+        if(version->retire_epoch < min_epoch)
+        {
+            *ptr = version->next;
+            version->next = 0;
+            if(reload->retire_callback != 0)
             {
-                MD_CmdLineOption *opt = MD_PushArray(MD_CmdLineOption, 1);
-                MD_MemoryZero(opt, sizeof(*opt));
-                opt->name = option_name;
-                opt->values = option_values;
-                if(cmdln.last_option == 0)
-                {
-                    cmdln.first_option = cmdln.last_option = opt;
-                }
-                else
-                {
-                    cmdln.last_option->next = opt;
-                    cmdln.last_option = cmdln.last_option->next;
-                }
+                reload->retire_callback(version, reload->retire_user_data);
             }
         }
-        
-        //- rjf: this argument is not an option, push it to regular inputs list.
         else
         {
-            MD_S8ListPush(&cmdln.inputs, n->string);
+            ptr = &version->next;
         }
     }
-    
-    return cmdln;
 }
 
-MD_FUNCTION MD_String8List
-MD_CmdLineValuesFromString(MD_CmdLine cmdln, MD_String8 name)
+// NOTE: Builds the child arrays and name indices that lookups would
+// otherwise build into the nodes on first use. Every node with children gets
+// a child array, even those that lookups would walk, since a read-only node
+// without one has MD_ChildArrayFromNode fill a new array on every call.
+MD_PRIVATE_FUNCTION_IMPL void
+_MD_HotReloadBuildLookups(MD_Node *node)
 {
-    MD_String8List values = MD_ZERO_STRUCT;
-    for(MD_CmdLineOption *opt = cmdln.first_option; opt; opt = opt->next)
+    if(node->child_count != 0)
     {
-        if(MD_S8Match(opt->name, name, 0))
+        MD_ChildArrayFromNode(node);
+    }
+    if(node->child_count >= _MD_NAME_INDEX_MIN_COUNT)
+    {
+        MD_IndexChildren(node);
+    }
+    for(MD_EachNode(tag, node->first_tag))
+    {
+        _MD_HotReloadBuildLookups(tag);
+    }
+    for(MD_EachNode(child, node->first_child))
+    {
+        _MD_HotReloadBuildLookups(child);
+    }
+}
+
+// NOTE: Compares in chunks on the stack, so that polling an unchanged
+// file allocates nothing.
+MD_PRIVATE_FUNCTION_IMPL MD_b32
+_MD_FileMatchesString(MD_String8 filename, MD_String8 string)
+{
+    MD_b32 result = 0;
+    FILE *file = fopen((char *)filename.str, "rb");
+    if(file)
+    {
+        MD_u8 buffer[4096];
+        MD_u64 off = 0;
+        for(result = 1; result;)
         {
-            values = opt->values;
-            break;
+            MD_u64 size = fread(buffer, 1, sizeof(buffer), file);
+            if(off + size > string.size || memcmp(buffer, string.str + off, size) != 0)
+            {
+                result = 0;
+            }
+            off += size;
+            if(size < sizeof(buffer))
+            {
+                break;
+            }
         }
+        result = result && off == string.size;
+        fclose(file);
     }
-    return values;
+    return result;
 }
 
-MD_FUNCTION MD_b32
-MD_CmdLineB32FromString(MD_CmdLine cmdln, MD_String8 name)
+MD_FUNCTION_IMPL MD_HotReload *
+MD_MakeHotReload(MD_String8 filename, MD_ParseOptions *options, MD_u64 reader_count)
+{
+    MD_HotReload *reload = MD_PushArrayZero(MD_HotReload, 1);
+    reload->filename = MD_S8Copy(filename);
+    if(options != 0)
+    {
+        reload->options = *options;
+    }
+    // NOTE: Both would have the reloading thread write to memory that
+    // readers use; lazy sets are expanded by readers, and the index is shared.
+    reload->options.flags &= ~MD_ParseFlag_LazySets;
+    reload->options.index = 0;
+    reload->epoch = 1;
+    reload->readers = MD_PushArrayZero(MD_HotReloadReader, reader_count);
+    reload->reader_count = reader_count;
+    MD_HotReloadPoll(reload);
+    return reload;
+}
+
+MD_FUNCTION_IMPL MD_b32
+MD_HotReloadPoll(MD_HotReload *reload)
 {
     MD_b32 result = 0;
-    for(MD_CmdLineOption *opt = cmdln.first_option; opt; opt = opt->next)
+    MD_HotReloadVersion *current = (MD_HotReloadVersion *)_MD_AtomicLoadPtr((void *volatile *)&reload->current);
+    if(current == 0 || !_MD_FileMatchesString(reload->filename, current->contents))
     {
-        if(MD_S8Match(opt->name, name, 0))
+        MD_String8 contents = MD_LoadEntireFile(reload->filename);
+        if(contents.str != 0)
         {
-            result = 1;
-            break;
+            result = MD_HotReloadPublishString(reload, contents);
         }
     }
+    if(!result)
+    {
+        _MD_HotReloadRetire(reload);
+    }
     return result;
 }
 
-MD_FUNCTION MD_i64
-MD_CmdLineI64FromString(MD_CmdLine cmdln, MD_String8 name)
+MD_FUNCTION_IMPL MD_b32
+MD_HotReloadPublishString(MD_HotReload *reload, MD_String8 contents)
 {
-    MD_i64 v = 0;
-    MD_String8List values = MD_CmdLineValuesFromString(cmdln, name);
-    MD_String8 value_str = MD_S8ListJoin(values, 0);
-    v = MD_CStyleIntFromString(value_str);
-    return v;
+    MD_b32 result = 0;
+    MD_ParseResult parse = MD_ParseWholeStringWithOptions(reload->filename, contents, &reload->options);
+    reload->errors = parse.errors;
+    if(parse.errors.max_message_kind < MD_MessageKind_Error)
+    {
+        MD_HotReloadVersion *version = MD_PushArrayZero(MD_HotReloadVersion, 1);
+        version->parse = parse;
+        version->contents = contents;
+        
+        //- build what readers would build lazily, then stop further caching
+        _MD_HotReloadBuildLookups(parse.node);
+        _MD_LineTableFromRoot(parse.node)->read_only = 1;
+        
+        //- swap in the new version, then advance the epoch
+        MD_HotReloadVersion *old = (MD_HotReloadVersion *)_MD_AtomicExchangePtr((void *volatile *)&reload->current,
+                                                                                version);
+        if(old != 0)
+        {
+            old->retire_epoch = reload->epoch;
+            old->next = reload->first_retired;
+            reload->first_retired = old;
+        }
+        _MD_AtomicStoreU64(&reload->epoch, reload->epoch + 1);
+        result = 1;
+    }
+    _MD_HotReloadRetire(reload);
+    return result;
 }
 
-//~ File System
-
-MD_FUNCTION_IMPL MD_String8
-MD_LoadEntireFile(MD_String8 filename)
+MD_FUNCTION_IMPL MD_Node *
+MD_HotReloadBeginRead(MD_HotReload *reload, MD_u64 reader_index)
 {
-    MD_String8 file_contents = MD_ZERO_STRUCT;
-    FILE *file = fopen((char*)MD_S8Copy(filename).str, "rb");
-    if(file)
+    MD_Node *result = MD_NilNode();
+    if(reader_index < reload->reader_count)
     {
-        fseek(file, 0, SEEK_END);
-        MD_u64 file_size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        file_contents.str = MD_PushArray(MD_u8, file_size+1);
-        if(file_contents.str)
+        MD_HotReloadReader *reader = &reload->readers[reader_index];
+        _MD_AtomicStoreU64(&reader->epoch, _MD_AtomicLoadU64(&reload->epoch));
+        MD_HotReloadVersion *version = (MD_HotReloadVersion *)_MD_AtomicLoadPtr((void *volatile *)&reload->current);
+        if(version != 0)
         {
-            file_contents.size = file_size;
-            fread(file_contents.str, 1, file_size, file);
+            result = version->parse.node;
         }
-        fclose(file);
     }
-    return file_contents;
+    return result;
 }
 
-MD_FUNCTION_IMPL MD_b32
-MD_FileIterIncrement(MD_FileIter *it, MD_String8 path, MD_FileInfo *out_info)
+MD_FUNCTION_IMPL void
+MD_HotReloadEndRead(MD_HotReload *reload, MD_u64 reader_index)
 {
-#if !defined(MD_IMPL_FileIterIncrement)
-    return(0);
-#else
-    return(MD_IMPL_FileIterIncrement(it, path, out_info));
-#endif
+    if(reader_index < reload->reader_count)
+    {
+        _MD_AtomicStoreU64(&reload->readers[reader_index].epoch, 0);
+    }
 }
 
 /*
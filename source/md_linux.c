@@ -2,6 +2,7 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/syscall.h>
@@ -72,6 +73,33 @@ MD_LINUX_FileIterIncrement(MD_FileIter *opaque_it, MD_String8 path, MD_FileInfo
     return result;
 }
 
+#define MD_IMPL_MapEntireFile MD_LINUX_MapEntireFile
+
+// NOTE: Private mapping, so the caller may write to the pages (copy-on-write)
+// without the changes reaching the file.
+static MD_String8
+MD_LINUX_MapEntireFile(MD_String8 filename)
+{
+    MD_String8 result = MD_ZERO_STRUCT;
+    MD_String8 cfilename = MD_S8Copy(filename);
+    int fd = open((char *)cfilename.str, O_RDONLY|O_CLOEXEC);
+    if(fd != -1)
+    {
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *base = mmap(0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if(base != MAP_FAILED)
+            {
+                result.str = (MD_u8 *)base;
+                result.size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+    return result;
+}
+
 /*
 Copyright 2021 Dion Systems LLC
 
@@ -48,6 +48,16 @@ MD_C_LINKAGE_BEGIN
 
 HANDLE FindFirstFileA(LPCSTR lpFileName, LPWIN32_FIND_DATAA lpFindFileData);
 BOOL FindNextFileA(HANDLE hFindFile, LPWIN32_FIND_DATAA lpFindFileData);
+HANDLE CreateFileA(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, void *lpSecurityAttributes,
+                   DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
+DWORD GetFileSize(HANDLE hFile, DWORD *lpFileSizeHigh);
+HANDLE CreateFileMappingA(HANDLE hFile, void *lpFileMappingAttributes, DWORD flProtect,
+                          DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCSTR lpName);
+void *MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess, DWORD dwFileOffsetHigh,
+                    DWORD dwFileOffsetLow, size_t dwNumberOfBytesToMap);
+BOOL CloseHandle(HANDLE hObject);
+BOOL CreateDirectoryA(LPCSTR lpPathName, void *lpSecurityAttributes);
+BOOL RemoveDirectoryA(LPCSTR lpPathName);
 
 MD_C_LINKAGE_END
 
@@ -96,6 +106,47 @@ MD_WIN32_FileIterIncrement(MD_FileIter *it, MD_String8 path, MD_FileInfo *out_in
     return result;
 }
 
+#define MD_IMPL_MapEntireFile MD_WIN32_MapEntireFile
+
+// NOTE: Copy-on-write view, so the caller may write to the pages without
+// the changes reaching the file.
+static MD_String8
+MD_WIN32_MapEntireFile(MD_String8 filename)
+{
+#define MD_WIN32_GENERIC_READ         0x80000000
+#define MD_WIN32_FILE_SHARE_READ      0x00000001
+#define MD_WIN32_OPEN_EXISTING        3
+#define MD_WIN32_INVALID_HANDLE_VALUE ((HANDLE)(MD_i64)-1)
+#define MD_WIN32_PAGE_WRITECOPY       0x08
+#define MD_WIN32_FILE_MAP_COPY        0x01
+    MD_String8 result = MD_ZERO_STRUCT;
+    MD_String8 cfilename = MD_S8Copy(filename);
+    HANDLE file = CreateFileA((char *)cfilename.str, MD_WIN32_GENERIC_READ, MD_WIN32_FILE_SHARE_READ, 0,
+                              MD_WIN32_OPEN_EXISTING, 0, 0);
+    if(file != MD_WIN32_INVALID_HANDLE_VALUE)
+    {
+        DWORD size_high = 0;
+        DWORD size_low = GetFileSize(file, &size_high);
+        MD_u64 size = ((((MD_u64)size_high) << 32) | ((MD_u64)size_low));
+        if(size > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(file, 0, MD_WIN32_PAGE_WRITECOPY, 0, 0, 0);
+            if(mapping != 0)
+            {
+                void *base = MapViewOfFile(mapping, MD_WIN32_FILE_MAP_COPY, 0, 0, 0);
+                if(base != 0)
+                {
+                    result.str = (MD_u8 *)base;
+                    result.size = size;
+                }
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+    return result;
+}
+
 /*
 Copyright 2021 Dion Systems LLC
 
@@ -4,6 +4,11 @@
 #include "md.c"
 #include "md_c_helpers.c"
 
+#if !MD_OS_WINDOWS
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 static struct
 {
     int number_of_tests;
@@ -116,6 +121,65 @@ TokenMatch(MD_Token token, MD_String8 string, MD_TokenKind kind)
     return MD_S8Match(string, token.string, 0) && token.kind == kind;
 }
 
+static void
+MakeTestDirectory(MD_String8 path)
+{
+#if MD_OS_WINDOWS
+    CreateDirectoryA((char *)path.str, 0);
+#else
+    mkdir((char *)path.str, 0777);
+#endif
+}
+
+static void
+RemoveTestDirectory(MD_String8 path)
+{
+#if MD_OS_WINDOWS
+    RemoveDirectoryA((char *)path.str);
+#else
+    rmdir((char *)path.str);
+#endif
+}
+
+static void
+RecordParseEvent(MD_ParseEvent *event, void *user_data)
+{
+    MD_String8List *events = (MD_String8List *)user_data;
+    char kind_chars[] = { 'N', 'T', '[', ']', 'C', 'E' };
+    MD_S8ListPush(events, MD_S8Fmt("%c%i%.*s ", kind_chars[event->kind], (int)event->depth,
+                                   MD_S8VArg(event->kind == MD_ParseEventKind_Error ? MD_S8Lit("") : event->string)));
+}
+
+static MD_u64
+NodeStringSizeKey(MD_Node *node, void *user_data)
+{
+    return node->string.size;
+}
+
+static MD_b32
+NodeHasTagFilter(MD_Node *node, void *user_data)
+{
+    return MD_NodeHasTag(node, *(MD_String8 *)user_data, 0);
+}
+
+static MD_String8
+NodeStringKey(MD_Node *node, void *user_data)
+{
+    return node->string;
+}
+
+static MD_u64
+NodeTagArgKey(MD_Node *node, void *user_data)
+{
+    return MD_U64FromString(MD_TagArgFromIndex(node, MD_S8Lit("order"), 0, 0)->string, 10);
+}
+
+static void
+CountRetiredVersion(MD_HotReloadVersion *version, void *user_data)
+{
+    *(int *)user_data += MD_ChildCountFromNode(version->parse.node) != 0;
+}
+
 int main(void)
 {
     Test("Lexer")
@@ -887,5 +951,1050 @@ int main(void)
         }
     }
     
+    Test("Lazy Sets")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("a: {x: (1, 2) y: \"}\" /* } */ z}\n@tag(t) b: [c]\nd: e f");
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags |= MD_ParseFlag_LazySets;
+        MD_ParseResult eager = MD_ParseWholeString(file_name, text);
+        MD_ParseResult lazy = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        MD_Node *a = lazy.node->first_child;
+        TestResult(lazy.errors.first == 0);
+        TestResult(MD_ChildCountFromNode(lazy.node) == 3);
+        TestResult(a->unexpanded != 0 && MD_NodeIsNil(a->first_child));
+        TestResult(a->flags & MD_NodeFlag_HasBraceLeft && a->flags & MD_NodeFlag_HasBraceRight);
+        TestResult(MD_ChildCountFromNode(a) == 2 && a->unexpanded == 0);
+        TestResult(MD_ChildFromString(a, MD_S8Lit("x"), 0)->unexpanded != 0);
+        TestResult(MD_NodeHasTag(a->next, MD_S8Lit("tag"), 0));
+        TestResult(MD_NodeDeepMatch(eager.node, lazy.node, MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        
+        MD_ParseResult broken = MD_ParseWholeStringWithOptions(file_name, MD_S8Lit("a: {b: {c )}}"), &options);
+        MD_Node *b = MD_FirstChildFromNode(broken.node->first_child);
+        TestResult(broken.errors.first == 0 && b->unexpanded != 0);
+        MD_ParseResult expanded = MD_ExpandNode(b);
+        TestResult(expanded.errors.first != 0 &&
+                   MD_CodeLocFromNode(expanded.errors.first->node).column == 11);
+    }
+    
+    Test("Binary Trees")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("// hello\n@foo(1, 2) a: {b c} // after\n\"esc\\\"aped\" d: e\n]");
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags |= MD_ParseFlag_LazySets;
+        MD_ParseResult eager = MD_ParseWholeString(file_name, text);
+        MD_ParseResult lazy = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        MD_String8 binary = MD_BinaryFromParseResult(lazy);
+        MD_ParseResult loaded = MD_ParseResultFromBinary(binary);
+        MD_Node *a = loaded.node->first_child;
+        TestResult(MD_NodeDeepMatch(eager.node, loaded.node, MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        TestResult(MD_S8Match(loaded.node->string, file_name, 0));
+        TestResult(MD_S8Match(a->prev_comment, MD_S8Lit(" hello"), 0));
+        TestResult(MD_S8Match(a->next_comment, MD_S8Lit(" after"), 0));
+        TestResult(a->offset == eager.node->first_child->offset && a->flags == eager.node->first_child->flags);
+        TestResult(MD_RootFromNode(a->first_child) == loaded.node);
+        TestResult(loaded.errors.first != 0 && loaded.errors.node_count == eager.errors.node_count);
+        TestResult(MD_S8Match(loaded.errors.first->string, eager.errors.first->string, 0));
+        TestResult(MD_CodeLocFromNode(loaded.errors.first->node).line == 4);
+        
+        MD_String8 truncated = MD_S8Copy(MD_S8Prefix(MD_BinaryFromParseResult(eager), 64));
+        MD_ParseResult bad = MD_ParseResultFromBinary(truncated);
+        TestResult(MD_NodeIsNil(bad.node) && bad.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+    }
+    
+    Test("Parse Cache")
+    {
+        MD_String8 file_name = MD_S8Lit("__parse_cache_test.mdesk");
+        MD_String8 cache_dir = MD_S8Lit("__parse_cache_test");
+        MakeTestDirectory(cache_dir);
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.cache_dir = cache_dir;
+        
+        MD_String8 text = MD_S8Lit("@foo a: {b c} d: ]");
+        MD_WriteEntireFile(file_name, text);
+        MD_ParseResult eager = MD_ParseWholeString(file_name, text);
+        MD_ParseResult miss = MD_ParseWholeFileWithOptions(file_name, &options);
+        MD_ParseResult hit = MD_ParseWholeFileWithOptions(file_name, &options);
+        TestResult(MD_NodeDeepMatch(eager.node, miss.node, MD_NodeMatchFlag_Tags));
+        TestResult(MD_NodeDeepMatch(eager.node, hit.node, MD_NodeMatchFlag_Tags));
+        TestResult(hit.errors.node_count == eager.errors.node_count && hit.errors.node_count != 0);
+        TestResult(MD_S8Match(hit.node->string, file_name, 0));
+        
+        MD_String8 changed_text = MD_S8Lit("@foo a: {b c d}");
+        MD_WriteEntireFile(file_name, changed_text);
+        MD_ParseResult changed = MD_ParseWholeFileWithOptions(file_name, &options);
+        TestResult(MD_ChildCountFromNode(changed.node->first_child) == 3 && changed.errors.first == 0);
+        
+        MD_ParseOptions lazy_options = options;
+        lazy_options.flags = MD_ParseFlag_LazySets;
+        MD_ParseResult lazy_hit = MD_ParseWholeFileWithOptions(file_name, &lazy_options);
+        TestResult(lazy_hit.node->first_child->unexpanded == 0 && lazy_hit.node->first_child->child_count == 3);
+        MD_WriteEntireFile(file_name, MD_S8Lit("a: {b c d e}"));
+        MD_ParseResult lazy_miss = MD_ParseWholeFileWithOptions(file_name, &lazy_options);
+        TestResult(lazy_miss.node->first_child->unexpanded != 0);
+        
+        int entry_count = 0;
+        MD_FileInfo info = MD_ZERO_STRUCT;
+        for(MD_FileIter it = MD_ZERO_STRUCT; MD_FileIterIncrement(&it, cache_dir, &info);)
+        {
+            if(!MD_S8Match(info.filename, MD_S8Lit("."), 0) && !MD_S8Match(info.filename, MD_S8Lit(".."), 0))
+            {
+                entry_count += MD_S8Match(MD_PathSkipLastPeriod(info.filename), MD_S8Lit("mdb"), 0);
+                remove((char *)MD_S8Fmt("%.*s/%.*s", MD_S8VArg(cache_dir), MD_S8VArg(info.filename)).str);
+            }
+        }
+        RemoveTestDirectory(cache_dir);
+        remove((char *)file_name.str);
+        TestResult(entry_count == 2);
+    }
+    
+    Test("Parse Events")
+    {
+        MD_String8 text = MD_S8Lit("// c\n@t(1) a: {b, c} // n\nd: (e)\n}");
+        MD_String8List events = MD_ZERO_STRUCT;
+        MD_MessageKind max_kind = MD_ParseEventsFromString(text, 0, RecordParseEvent, &events);
+        MD_String8 joined = MD_S8ListJoin(events, 0);
+        TestResult(MD_S8Match(joined, MD_S8Lit("C0 c T0t [0t N11 ]0t N0a [0a N1b N1c ]0a C0 n "
+                                               "N0d [0d N1e ]0d E0 "), 0));
+        TestResult(max_kind == MD_MessageKind_CatastrophicError);
+        
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags |= MD_ParseFlag_LazySets;
+        MD_String8List lazy_events = MD_ZERO_STRUCT;
+        MD_ParseEventsFromString(text, &options, RecordParseEvent, &lazy_events);
+        TestResult(MD_S8Match(MD_S8ListJoin(lazy_events, 0), joined, 0));
+    }
+    
+    Test("Structural Index")
+    {
+        MD_String8List parts = MD_ZERO_STRUCT;
+        for(int i = 0; i < 8; i += 1)
+        {
+            MD_S8ListPush(&parts, MD_S8Lit("abc: {x: \"a string {with} (brackets) that spans \\\" blocks\", y: 1/2}\n"
+                                           "/* nested /* {comment} */ ) */ @tag(1 2) d: ['}', `(`, \"\"\"[\n]\"\"\"]\n"
+                                           "e: { f ) } # \\ ; \n"));
+        }
+        MD_S8ListPush(&parts, MD_S8Lit("g: \"open\n/* open /* nested */"));
+        MD_String8 text = MD_S8ListJoin(parts, 0);
+        MD_StructuralIndex index = MD_StructuralIndexFromString(text);
+        
+        MD_b32 offsets_match = 1;
+        MD_b32 tokens_match = 1;
+        MD_u64 entry = 0;
+        for(MD_u64 off = 0; off < text.size;)
+        {
+            MD_Token token = MD_TokenFromString(MD_S8Skip(text, off));
+            if(token.kind & (MD_TokenKind_Reserved|MD_TokenKind_Newline|MD_TokenKind_Comment|MD_TokenKind_StringLiteral|
+                             MD_TokenKind_BrokenComment|MD_TokenKind_BrokenStringLiteral))
+            {
+                offsets_match = offsets_match && entry < index.count && index.offsets[entry] == off;
+                tokens_match = (tokens_match && entry < index.count && index.kinds[entry] == token.kind &&
+                                index.ends[entry] == off + token.raw_string.size);
+                entry += 1;
+            }
+            off += token.raw_string.size;
+        }
+        TestResult(offsets_match && entry == index.count);
+        TestResult(tokens_match);
+        
+        MD_b32 partners_match = 1;
+        for(MD_u64 i = 0; i < index.count; i += 1)
+        {
+            MD_u8 c = text.str[index.offsets[i]];
+            MD_u64 partner = index.partners[i];
+            partners_match = partners_match && index.partners[partner] == i;
+            if(c == '{' || c == '(' || c == '[')
+            {
+                partners_match = partners_match && partner > i;
+            }
+            if(c == ')' && text.str[index.offsets[i] - 2] == 'f')
+            {
+                partners_match = partners_match && partner == i;
+            }
+        }
+        TestResult(partners_match);
+        
+        MD_u64 e_brace = MD_StructuralIndexEntryFromOffset(&index, MD_S8FindSubstring(text, MD_S8Lit("{ f"), 0, 0));
+        TestResult(text.str[index.offsets[index.partners[e_brace]] - 2] == ')');
+    }
+    
+    Test("Structural Index Parsing")
+    {
+        MD_String8List parts = MD_ZERO_STRUCT;
+        MD_String8 filler = MD_S8Lit("a long string, so that tokens are read from the structural index");
+        for(int i = 0; i < 1024; i += 1)
+        {
+            MD_S8ListPush(&parts, MD_S8Fmt("/* %.*s /* nested */ */\n@doc(\"%.*s\") n%i: {\n"
+                                           "    x: `%.*s`, // %.*s\n"
+                                           "    y: ['''%.*s''' \"\\\" %.*s\"]\n}\n",
+                                           MD_S8VArg(filler), MD_S8VArg(filler), i, MD_S8VArg(filler),
+                                           MD_S8VArg(filler), MD_S8VArg(filler), MD_S8VArg(filler)));
+        }
+        MD_S8ListPush(&parts, MD_S8Lit("z: \"open\n/* open"));
+        MD_String8 text = MD_S8ListJoin(parts, 0);
+        
+        // NOTE: MD_ParseNodeSet never reads tokens from an index.
+        MD_ParseResult indexed = MD_ParseWholeString(MD_S8Lit("raw_text"), text);
+        MD_Node *root = MD_MakeNode(MD_NodeKind_File, MD_S8Lit("raw_text"), text, 0);
+        MD_ParseResult lexed = MD_ParseNodeSet(text, 0, root, MD_ParseSetRule_Global);
+        MD_b32 errors_match = (indexed.errors.node_count == 3 && lexed.errors.node_count == 3);
+        for(MD_Message *a = indexed.errors.first, *b = lexed.errors.first; a != 0 && b != 0; a = a->next, b = b->next)
+        {
+            errors_match = (errors_match && MD_S8Match(a->string, b->string, 0) &&
+                            a->node->offset == b->node->offset);
+        }
+        TestResult(errors_match);
+        
+        MD_ParseResult lexed_tree = MD_ParseResultZero();
+        lexed_tree.node = lexed_tree.last_node = root;
+        MD_String8 lexed_binary = MD_BinaryFromParseResult(lexed_tree);
+        indexed.errors = lexed_tree.errors;
+        TestResult(MD_S8Match(MD_BinaryFromParseResult(indexed), lexed_binary, 0));
+        
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags = MD_ParseFlag_LazySets;
+        MD_ParseResult lazy = MD_ParseWholeStringWithOptions(MD_S8Lit("raw_text"), text, &options);
+        lazy.errors = lexed_tree.errors;
+        TestResult(MD_S8Match(MD_BinaryFromParseResult(lazy), lexed_binary, 0));
+    }
+    
+    Test("Parse Flags")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("// before\n@foo(x: {y}) @bar a: b // after\n"
+                                   "@baz(1 c: (d e) f\n");
+        MD_ParseResult full = MD_ParseWholeString(file_name, text);
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        
+        options.flags = MD_ParseFlag_SkipComments;
+        MD_ParseResult no_comments = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(MD_NodeDeepMatch(full.node, no_comments.node, MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        TestResult(full.node->first_child->prev_comment.size != 0 &&
+                   full.node->first_child->first_child->next_comment.size != 0);
+        TestResult(no_comments.node->first_child->prev_comment.size == 0 &&
+                   no_comments.node->first_child->first_child->next_comment.size == 0);
+        
+        options.flags = MD_ParseFlag_SkipTags;
+        MD_ParseResult no_tags = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(MD_NodeDeepMatch(full.node, no_tags.node, 0));
+        TestResult(MD_NodeIsNil(no_tags.node->first_child->first_tag));
+        TestResult(no_tags.errors.node_count == full.errors.node_count && no_tags.errors.node_count != 0);
+        
+        options.flags = MD_ParseFlag_TerseErrors;
+        MD_ParseResult terse = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(MD_NodeDeepMatch(full.node, terse.node, MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        TestResult(MD_S8Match(full.errors.first->string, MD_S8Lit("Unbalanced \"(\""), 0));
+        TestResult(MD_S8Match(terse.errors.first->string, MD_S8Lit("Unbalanced delimiter"), 0));
+    }
+    
+    Test("Parse Limits")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("a: {b: {c: {d}}}\ne f g h\n");
+        MD_ParseResult full = MD_ParseWholeString(file_name, text);
+        TestResult(full.errors.max_message_kind < MD_MessageKind_CatastrophicError);
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        
+        options.max_depth = 1;
+        MD_ParseResult shallow = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(shallow.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(shallow.errors.node_count == 1);
+        TestResult(MD_S8Match(shallow.node->first_child->string, MD_S8Lit("a"), 0));
+        TestResult(MD_S8Match(shallow.node->first_child->first_child->string, MD_S8Lit("b"), 0));
+        TestResult(MD_NodeIsNil(shallow.node->first_child->first_child->first_child));
+        TestResult(MD_NodeIsNil(shallow.node->first_child->next));
+        
+        options.max_depth = 2;
+        MD_ParseResult deep = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(deep.errors.node_count == 1);
+        TestResult(MD_S8Match(deep.node->first_child->first_child->first_child->string, MD_S8Lit("c"), 0));
+        TestResult(MD_NodeIsNil(deep.node->first_child->first_child->first_child->first_child));
+        
+        options.max_depth = 3;
+        MD_ParseResult enough = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(MD_NodeDeepMatch(full.node, enough.node, 0) && enough.errors.node_count == 0);
+        
+        MD_MemoryZero(&options, sizeof(options));
+        options.max_node_count = 6;
+        MD_ParseResult few = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(few.errors.node_count == 1);
+        TestResult(few.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(MD_ChildCountFromNode(few.node) == 3);
+        TestResult(MD_S8Match(few.node->last_child->string, MD_S8Lit("f"), 0));
+        
+        MD_MemoryZero(&options, sizeof(options));
+        options.max_step_count = 4;
+        MD_ParseResult brief = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(brief.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(!MD_NodeDeepMatch(full.node, brief.node, 0));
+        
+        MD_MemoryZero(&options, sizeof(options));
+        options.max_byte_count = 1;
+        MD_ParseResult tiny = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(tiny.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(MD_ChildCountFromNode(tiny.node) == 1);
+        
+        MD_String8List sets = MD_ZERO_STRUCT;
+        for(int i = 0; i < 2000; i += 1)
+        {
+            MD_S8ListPush(&sets, MD_S8Lit("a: {b c} "));
+        }
+        options.flags = MD_ParseFlag_LazySets;
+        options.max_byte_count = 8192;
+        MD_ParseResult lazy = MD_ParseWholeStringWithOptions(file_name, MD_S8ListJoin(sets, 0), &options);
+        TestResult(lazy.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(lazy.node->first_child->unexpanded == 0 && lazy.node->first_child->child_count == 2);
+    }
+    
+    Test("Error Suppression")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        
+        MD_ParseResult run = MD_ParseWholeString(file_name, MD_S8Lit("a \xE2\x80\x94 b"));
+        TestResult(run.errors.node_count == 1 && MD_ChildCountFromNode(run.node) == 2);
+        TestResult(MD_S8Match(run.errors.first->string, MD_S8Lit("Non-ASCII characters \"0xE2 0x80 0x94\""), 0));
+        TestResult(MD_S8Match(run.errors.first->node->string, MD_S8Lit("\xE2\x80\x94"), 0));
+        
+        MD_u8 junk[64];
+        for(int i = 0; i < sizeof(junk); i += 1)
+        {
+            junk[i] = (i % 7 == 3) ? ' ' : (MD_u8)(0x80 + i);
+        }
+        MD_ParseResult storm = MD_ParseWholeString(file_name, MD_S8(junk, sizeof(junk)));
+        TestResult(storm.errors.node_count == 1 && MD_NodeIsNil(storm.node->first_child));
+        TestResult(storm.errors.first->node->string.size == sizeof(junk));
+        
+        MD_String8 text = MD_S8Lit("a \xFF b ) c ) d ) e");
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        MD_ParseResult all = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(all.errors.node_count == 4);
+        options.max_error_count = 1;
+        MD_ParseResult capped = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        TestResult(capped.errors.node_count == 2 && capped.errors.last->kind == MD_MessageKind_Note);
+        TestResult(capped.errors.max_message_kind == MD_MessageKind_CatastrophicError);
+        TestResult(MD_NodeDeepMatch(all.node, capped.node, 0));
+    }
+    
+    Test("UTF-8 Identifiers")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("gr\xC3\xB6\xC3\x9F" "e: \xE6\x97\xA5\xE6\x9C\xAC_1 x\xE2\x80\x94y\n"
+                                   "abcdefghijklmnopqrstuvwxyz_0123456789ABCDEFGH\xC3\xA9ijk \xC3 z");
+        MD_ParseResult ascii = MD_ParseWholeString(file_name, text);
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags = MD_ParseFlag_UTF8;
+        MD_ParseResult utf8 = MD_ParseWholeStringWithOptions(file_name, text, &options);
+        
+        TestResult(ascii.errors.node_count > 2);
+        TestResult(utf8.errors.node_count == 2);
+        MD_Node *first = utf8.node->first_child;
+        TestResult(MD_S8Match(first->string, MD_S8Lit("gr\xC3\xB6\xC3\x9F" "e"), 0));
+        TestResult(MD_S8Match(first->first_child->string, MD_S8Lit("\xE6\x97\xA5\xE6\x9C\xAC_1"), 0));
+        TestResult(MD_S8Match(first->first_child->next->string, MD_S8Lit("x"), 0));
+        TestResult(MD_S8Match(first->last_child->string, MD_S8Lit("y"), 0));
+        TestResult(MD_S8Match(utf8.errors.first->node->string, MD_S8Lit("\xE2\x80\x94"), 0));
+        TestResult(MD_S8Match(first->next->string,
+                              MD_S8Lit("abcdefghijklmnopqrstuvwxyz_0123456789ABCDEFGH\xC3\xA9ijk"), 0));
+        TestResult(MD_S8Match(utf8.errors.last->node->string, MD_S8Lit("\xC3"), 0));
+        TestResult(MD_S8Match(utf8.node->last_child->string, MD_S8Lit("z"), 0));
+        
+        MD_Token token = MD_TokenFromStringWithFlags(MD_S8Lit("\xCE\xB1\xCE\xB2 "), MD_LexFlag_UTF8);
+        TestResult(token.kind == MD_TokenKind_Identifier && token.raw_string.size == 4);
+        token = MD_TokenFromString(MD_S8Lit("\xCE\xB1\xCE\xB2 "));
+        TestResult(token.kind == MD_TokenKind_BadCharacter && token.raw_string.size == 1);
+        token = MD_TokenFromStringWithFlags(MD_S8Lit("\xC0\x80"), MD_LexFlag_UTF8);
+        TestResult(token.kind == MD_TokenKind_BadCharacter && token.raw_string.size == 1);
+    }
+    
+    Test("Code Locations")
+    {
+        MD_String8 file_name = MD_S8Lit("raw_text");
+        MD_String8 text = MD_S8Lit("a b\n\n  c: {d\r\n\"\xC3\xA9\xC3\xA9\" e}\n"
+                                   "0123456789012345678901234567890123456789 f\n");
+        MD_ParseResult parse = MD_ParseWholeString(file_name, text);
+        MD_Node *root = parse.node;
+        
+        MD_b32 all_match = 1;
+        MD_u64 offsets[128];
+        for(MD_u64 off = 0; off <= text.size; off += 1)
+        {
+            MD_CodeLoc expected = MD_CodeLocFromFileOffset(file_name, text.str, off);
+            MD_CodeLoc actual = MD_CodeLocFromRootOffset(root, off, 0);
+            all_match = all_match && (expected.line == actual.line && expected.column == actual.column &&
+                                      MD_S8Match(expected.filename, actual.filename, 0));
+            offsets[off] = off;
+        }
+        TestResult(all_match);
+        
+        MD_Node *e = MD_ChildFromString(MD_ChildFromString(root, MD_S8Lit("c"), 0), MD_S8Lit("e"), 0);
+        MD_CodeLoc loc = MD_CodeLocFromNode(e);
+        TestResult(loc.line == 4 && loc.column == 8);
+        loc = MD_CodeLocFromRootOffset(root, e->offset, MD_CodeLocFlag_CodepointColumns);
+        TestResult(loc.line == 4 && loc.column == 6);
+        
+        MD_CodeLoc locs[128];
+        MD_CodeLocsFromRootOffsets(root, offsets, text.size + 1, 0, locs);
+        all_match = 1;
+        for(MD_u64 off = 0; off <= text.size; off += 1)
+        {
+            MD_CodeLoc expected = MD_CodeLocFromRootOffset(root, off, 0);
+            all_match = all_match && (expected.line == locs[off].line && expected.column == locs[off].column);
+        }
+        TestResult(all_match);
+        
+        MD_u64 unsorted[4] = {e->offset, 0, text.size, 3};
+        MD_CodeLocsFromRootOffsets(root, unsorted, 4, 0, locs);
+        TestResult(locs[0].line == 4 && locs[1].line == 1 && locs[2].line == 6 && locs[3].column == 4);
+    }
+    
+    Test("Child Indexing")
+    {
+        MD_String8List row = {0};
+        MD_S8ListPush(&row, MD_S8Lit("@a @b(x) @c row: {"));
+        for(int i = 0; i < 100; i += 1)
+        {
+            MD_S8ListPush(&row, MD_S8Fmt("c%i ", i));
+        }
+        MD_S8ListPush(&row, MD_S8Lit("}"));
+        MD_String8 text = MD_S8ListJoin(row, 0);
+        
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags = MD_ParseFlag_LazySets;
+        MD_ParseResult parse = MD_ParseWholeStringWithOptions(MD_S8Lit("raw_text"), text, &options);
+        MD_Node *node = parse.node->first_child;
+        TestResult(MD_TagCountFromNode(node) == 3 && MD_ChildCountFromNode(node) == 100);
+        TestResult(MD_S8Match(MD_TagFromIndex(node, 1)->string, MD_S8Lit("b"), 0));
+        TestResult(MD_IndexFromNode(node->last_tag) == 2);
+        
+        MD_b32 all_match = 1;
+        int idx = 0;
+        for(MD_EachNode(child, node->first_child))
+        {
+            all_match = all_match && (MD_ChildFromIndex(node, idx) == child && MD_IndexFromNode(child) == idx);
+            idx += 1;
+        }
+        TestResult(all_match);
+        TestResult(MD_NodeIsNil(MD_ChildFromIndex(node, 100)) && MD_NodeIsNil(MD_ChildFromIndex(node, -1)));
+        
+        MD_Node *extra = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("extra"), MD_S8Lit("extra"), 0);
+        MD_PushChild(node, extra);
+        TestResult(MD_ChildCountFromNode(node) == 101 && MD_ChildFromIndex(node, 100) == extra);
+        TestResult(MD_ChildArrayFromNode(node)[100] == extra && MD_IndexFromNode(extra) == 100);
+        TestResult(MD_ChildCountFromNode(MD_NilNode()) == 0 && MD_NodeIsNil(MD_ChildFromIndex(MD_NilNode(), 0)));
+    }
+    
+    Test("Child Name Index")
+    {
+        MD_String8List list = {0};
+        MD_S8ListPush(&list, MD_S8Lit("schema: {"));
+        for(int i = 0; i < 1000; i += 1)
+        {
+            MD_S8ListPush(&list, MD_S8Fmt("field_%i: %i\n", i % 600, i));
+        }
+        MD_S8ListPush(&list, MD_S8Lit("}"));
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8ListJoin(list, 0));
+        MD_Node *schema = parse.node->first_child;
+        
+        MD_b32 all_match = 1;
+        for(int i = 0; i < 600; i += 1)
+        {
+            MD_String8 name = MD_S8Fmt("field_%i", i);
+            MD_Node *expected = MD_NodeFromString(schema->first_child, MD_NilNode(), name, 0);
+            all_match = all_match && (MD_ChildFromString(schema, name, 0) == expected &&
+                                      MD_IndexFromNode(expected) == i);
+        }
+        TestResult(all_match);
+        TestResult(MD_NodeIsNil(MD_ChildFromString(schema, MD_S8Lit("field_600"), 0)));
+        TestResult(MD_S8Match(MD_ChildFromString(schema, MD_S8Lit("FIELD_7"), MD_StringMatchFlag_CaseInsensitive)->string,
+                              MD_S8Lit("field_7"), 0));
+        
+        MD_Node *late = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("field_600"), MD_S8Lit("field_600"), 0);
+        MD_PushChild(schema, late);
+        TestResult(MD_ChildFromString(schema, MD_S8Lit("field_600"), 0) == late);
+        
+        MD_Node *small = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("small"), MD_S8Lit("small"), 0);
+        MD_Node *a = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("a"), MD_S8Lit("a"), 0);
+        MD_PushChild(small, a);
+        MD_IndexChildren(small);
+        MD_Node *b = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("b"), MD_S8Lit("b"), 0);
+        MD_PushChild(small, b);
+        TestResult(MD_ChildFromString(small, MD_S8Lit("a"), 0) == a && MD_ChildFromString(small, MD_S8Lit("b"), 0) == b);
+        TestResult(MD_NodeIsNil(MD_ChildFromString(small, MD_S8Lit("c"), 0)));
+    }
+    
+    Test("Tag Bloom Filter")
+    {
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8Lit("@table @b(x) n\nm\n@A o\n"));
+        MD_Node *n = parse.node->first_child;
+        MD_Node *m = n->next;
+        MD_Node *o = m->next;
+        TestResult(n->tag_bloom != 0 && m->tag_bloom == 0);
+        TestResult(MD_NodeHasTag(n, MD_S8Lit("table"), 0) && MD_NodeHasTag(n, MD_S8Lit("b"), 0));
+        TestResult(!MD_NodeHasTag(n, MD_S8Lit("tab"), 0) && !MD_NodeHasTag(m, MD_S8Lit("table"), 0));
+        TestResult(!MD_NodeHasTag(o, MD_S8Lit("a"), 0) && MD_NodeHasTag(o, MD_S8Lit("a"), MD_StringMatchFlag_CaseInsensitive));
+        TestResult(MD_NodeHasTag(n, MD_S8Lit("tab"), MD_StringMatchFlag_RightSideSloppy));
+        
+        MD_Node *short_tags = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8Lit("@ptr p\n@doc d\n@id i\n@x x")).node;
+        MD_u64 ptr_bloom = short_tags->first_child->tag_bloom;
+        MD_u64 doc_bloom = short_tags->first_child->next->tag_bloom;
+        MD_u64 id_bloom = short_tags->first_child->next->next->tag_bloom;
+        MD_u64 x_bloom = short_tags->last_child->tag_bloom;
+        TestResult(ptr_bloom != doc_bloom && (ptr_bloom & doc_bloom) != ptr_bloom);
+        TestResult((id_bloom & x_bloom) != x_bloom && (ptr_bloom & id_bloom) != id_bloom);
+        
+        MD_Node *tag = MD_MakeNode(MD_NodeKind_Tag, MD_S8Lit("late"), MD_S8Lit("late"), 0);
+        MD_PushTag(m, tag);
+        TestResult(MD_NodeHasTag(m, MD_S8Lit("late"), 0) && !MD_NodeHasTag(m, MD_S8Lit("table"), 0));
+        
+        MD_Node *manual = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("manual"), MD_S8Lit("manual"), 0);
+        MD_Node *manual_tag = MD_MakeNode(MD_NodeKind_Tag, MD_S8Lit("t"), MD_S8Lit("t"), 0);
+        MD_NodeDblPushBack(manual->first_tag, manual->last_tag, manual_tag);
+        TestResult(MD_NodeHasTag(manual, MD_S8Lit("t"), 0) && MD_TagCountFromNode(manual) == 1);
+        MD_Node *manual_child = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("c"), MD_S8Lit("c"), 0);
+        MD_NodeDblPushBack(manual->first_child, manual->last_child, manual_child);
+        TestResult(MD_ChildCountFromNode(manual) == 1 && MD_ChildFromIndex(manual, 0) == manual_child);
+        
+        MD_Node *list = MD_MakeList();
+        MD_Node *items[3];
+        for(int i = 0; i < 3; i += 1)
+        {
+            items[i] = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("i"), MD_S8Lit("i"), 0);
+            MD_NodeDblPushBack(list->first_child, list->last_child, items[i]);
+        }
+        TestResult(MD_IndexFromNode(items[0]) == 0 && MD_IndexFromNode(items[2]) == 2);
+    }
+    
+    Test("Node Removal")
+    {
+        MD_Node *p = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8Lit("@x @y(1) @z p: {a b c}")).node->first_child;
+        MD_Node *b = MD_ChildFromString(p, MD_S8Lit("b"), 0);
+        MD_Node *c = MD_ChildFromString(p, MD_S8Lit("c"), 0);
+        MD_Node *expect = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8Lit("@x @z p: {a c}")).node->first_child;
+        MD_MatchFlags flags = MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments;
+        MD_NodeStructuralHash(p, flags);
+        MD_RemoveChild(p, b);
+        TestResult(MD_ChildCountFromNode(p) == 2 && MD_ChildFromIndex(p, 1) == c && MD_IndexFromNode(c) == 1);
+        TestResult(MD_NodeIsNil(MD_ChildFromString(p, MD_S8Lit("b"), 0)) && MD_ChildFromString(p, MD_S8Lit("c"), 0) == c);
+        TestResult(MD_NodeIsNil(b->parent) && MD_NodeIsNil(b->next) && MD_NodeIsNil(b->prev));
+        
+        MD_Node *y = MD_TagFromString(p, MD_S8Lit("y"), 0);
+        MD_Node *z = MD_TagFromString(p, MD_S8Lit("z"), 0);
+        MD_RemoveTag(p, y);
+        TestResult(MD_TagCountFromNode(p) == 2 && MD_IndexFromNode(z) == 1 && MD_TagFromIndex(p, 1) == z);
+        TestResult(!MD_NodeHasTag(p, MD_S8Lit("y"), 0) && MD_NodeHasTag(p, MD_S8Lit("z"), 0));
+        TestResult(MD_NodeDeepMatch(p, expect, flags));
+        
+        MD_Node *wide = MD_MakeList();
+        for(int i = 0; i < 32; i += 1)
+        {
+            MD_PushChild(wide, MD_MakeNode(MD_NodeKind_Main, MD_S8Fmt("n%i", i), MD_S8Lit(""), 0));
+        }
+        MD_ChildFromIndex(wide, 31);
+        MD_Node *n5 = MD_ChildFromString(wide, MD_S8Lit("n5"), 0);
+        MD_RemoveChild(wide, n5);
+        TestResult(MD_ChildCountFromNode(wide) == 31 && MD_ChildFromIndex(wide, 30) == wide->last_child &&
+                   MD_S8Match(MD_ChildFromIndex(wide, 5)->string, MD_S8Lit("n6"), 0));
+        TestResult(MD_NodeIsNil(MD_ChildFromString(wide, MD_S8Lit("n5"), 0)) && MD_IndexFromNode(wide->last_child) == 30);
+    }
+    
+    Test("Tree-Wide Indexes")
+    {
+        MD_String8 code = MD_S8Lit("@t @t a: { @t b, c: { @u(@t x) a } }\n@u d: (a)\n");
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), code);
+        MD_Index index = MD_IndexFromTree(parse.node);
+        MD_NodeArray t = MD_NodesFromTag(&index, MD_S8Lit("t"));
+        MD_NodeArray a = MD_NodesFromString(&index, MD_S8Lit("a"));
+        TestResult(t.count == 2 && MD_S8Match(t.v[0]->string, MD_S8Lit("a"), 0) &&
+                   MD_S8Match(t.v[1]->string, MD_S8Lit("b"), 0));
+        TestResult(a.count == 3 && a.v[0] == parse.node->first_child &&
+                   a.v[2]->parent == parse.node->last_child);
+        TestResult(MD_NodesFromString(&index, MD_S8Lit("x")).count == 0);
+        TestResult(MD_NodesFromTag(&index, MD_S8Lit("none")).count == 0);
+        
+        MD_Index parse_index = MD_MakeIndex();
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags = MD_ParseFlag_LazySets;
+        options.index = &parse_index;
+        MD_ParseResult lazy_parse = MD_ParseWholeStringWithOptions(MD_S8Lit("raw_text"), code, &options);
+        TestResult(MD_NodesFromString(&parse_index, MD_S8Lit("a")).count == 1);
+        MD_ExpandNode(lazy_parse.node->last_child);
+        MD_ExpandNode(lazy_parse.node->first_child);
+        a = MD_NodesFromString(&parse_index, MD_S8Lit("a"));
+        TestResult(a.count == 2 && a.v[1]->parent == lazy_parse.node->last_child);
+        MD_Node *lazy_c = MD_ChildFromString(lazy_parse.node->first_child, MD_S8Lit("c"), 0);
+        MD_ExpandNode(lazy_c);
+        a = MD_NodesFromString(&parse_index, MD_S8Lit("a"));
+        TestResult(a.count == 3 && a.v[0] == lazy_parse.node->first_child && a.v[1]->parent == lazy_c &&
+                   a.v[2]->parent == lazy_parse.node->last_child);
+        TestResult(MD_NodesFromTag(&parse_index, MD_S8Lit("u")).count == 2);
+        
+        MD_Node *c = MD_ChildFromString(parse.node->first_child, MD_S8Lit("c"), 0);
+        MD_IndexRemoveSubtree(&index, c);
+        TestResult(MD_NodesFromString(&index, MD_S8Lit("a")).count == 2);
+        TestResult(MD_NodesFromString(&index, MD_S8Lit("c")).count == 0);
+        TestResult(MD_NodesFromTag(&index, MD_S8Lit("u")).count == 1);
+        MD_IndexAddSubtree(&index, c);
+        a = MD_NodesFromString(&index, MD_S8Lit("a"));
+        TestResult(a.count == 3 && a.v[1]->parent == c);
+        
+        MD_ParseResult other = MD_ParseWholeString(MD_S8Lit("other"), MD_S8Lit("a"));
+        MD_IndexAddSubtree(&index, other.node);
+        MD_IndexAddSubtree(&index, parse.node->first_child->first_child);
+        a = MD_NodesFromString(&index, MD_S8Lit("a"));
+        TestResult(a.count == 4 && a.v[3] == other.node->first_child);
+    }
+    
+    Test("Selectors")
+    {
+        MD_String8 code = MD_S8Lit("types:\n"
+                                   "{\n"
+                                   "  @struct A: { members: { @serialize x, y, @serialize z } }\n"
+                                   "  @enum B: { members: { @serialize q } }\n"
+                                   "  @struct C: { members: { w } }\n"
+                                   "}\n"
+                                   "@serialize top\n");
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), code);
+        MD_Index index = MD_IndexFromTree(parse.node);
+        MD_Selector selectors[] =
+        {
+            MD_SelectorFromString(MD_S8Lit("types/*[@struct]/members/*[@serialize]")),
+            MD_SelectorFromString(MD_S8Lit("//*[@serialize]")),
+            MD_SelectorFromString(MD_S8Lit(" \"types\" // x ")),
+            MD_SelectorFromString(MD_S8Lit("*[!@serialize]")),
+            MD_SelectorFromString(MD_S8Lit("types/*/members/nothing")),
+        };
+        char *expected[] = { "x z", "x z q top", "x", "types", "" };
+        for(int i = 0; i < MD_ArrayCount(selectors); i += 1)
+        {
+            TestResult(selectors[i].errors.first == 0);
+            for(int use_index = 0; use_index < 2; use_index += 1)
+            {
+                MD_NodeArray nodes = MD_NodesFromSelector(parse.node, &selectors[i], use_index ? &index : 0);
+                MD_String8List strings = {0};
+                for(MD_u64 i_node = 0; i_node < nodes.count; i_node += 1)
+                {
+                    MD_S8ListPush(&strings, nodes.v[i_node]->string);
+                }
+                MD_StringJoin join = MD_ZERO_STRUCT;
+                join.mid = MD_S8Lit(" ");
+                TestResult(MD_S8Match(MD_S8ListJoin(strings, &join), MD_S8CString(expected[i]), 0));
+            }
+        }
+        
+        MD_Node *members = MD_ChildFromString(MD_ChildFromString(parse.node->first_child, MD_S8Lit("A"), 0),
+                                              MD_S8Lit("members"), 0);
+        MD_NodeArray relative = MD_NodesFromSelector(members, &selectors[1], &index);
+        TestResult(relative.count == 2 && relative.v[1]->parent == members);
+        
+        MD_Index lazy_index = MD_MakeIndex();
+        MD_ParseOptions lazy_options = MD_ZERO_STRUCT;
+        lazy_options.flags = MD_ParseFlag_LazySets;
+        lazy_options.index = &lazy_index;
+        MD_Node *lazy_root = MD_ParseWholeStringWithOptions(MD_S8Lit("f"), MD_S8Lit("a:{b:{c} b} d"), &lazy_options).node;
+        MD_Selector lazy_selector = MD_SelectorFromString(MD_S8Lit("a/b"));
+        TestResult(MD_NodesFromSelector(lazy_root, &lazy_selector, &lazy_index).count == 2);
+        TestResult(MD_NodesFromSelector(lazy_root, &lazy_selector, 0).count == 2);
+        MD_Node *lazy_d = lazy_root->last_child;
+        TestResult(MD_NodesFromSelector(lazy_d, &lazy_selector, &lazy_index).count == 0 && lazy_index.unexpanded.count == 0);
+
+        char *bad[] = { "", "types/", "types/[@struct]", "*[@]", "*[@struct", "a b" };
+        for(int i = 0; i < MD_ArrayCount(bad); i += 1)
+        {
+            MD_Selector selector = MD_SelectorFromString(MD_S8CString(bad[i]));
+            TestResult(selector.errors.max_message_kind == MD_MessageKind_Error);
+            TestResult(MD_NodesFromSelector(parse.node, &selector, 0).count == 0);
+        }
+    }
+    
+    Test("Frozen Trees")
+    {
+        MD_String8 code = MD_S8Lit("@a(1) x: { y, \"z\" }\n@b @c w\n[q r s t u v]\n");
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), code);
+        MD_FrozenTree tree = MD_FreezeTree(parse.node);
+        TestResult(tree.count == 16 && tree.subtree_sizes[0] == 16 && tree.nodes[0] == parse.node);
+        TestResult(tree.child_counts[0] == 3 && tree.tag_counts[0] == 0);
+        
+        MD_u32 x = tree.first_children[0];
+        TestResult(x == 1 && tree.tag_counts[x] == 1 && tree.child_counts[x] == 2 && tree.subtree_sizes[x] == 5);
+        TestResult(MD_S8Match(MD_StringFromFrozenNode(&tree, x + 1), MD_S8Lit("a"), 0));
+        TestResult(tree.kinds[x + 1] == MD_NodeKind_Tag && tree.parents[x + 2] == x + 1);
+        MD_String8List strings = {0};
+        for(MD_EachFrozenChild(child, &tree, x))
+        {
+            TestResult(tree.parents[child] == x);
+            MD_S8ListPush(&strings, MD_StringFromFrozenNode(&tree, child));
+        }
+        TestResult(MD_S8Match(MD_S8ListJoin(strings, 0), MD_S8Lit("yz"), 0));
+        
+        MD_u32 w = tree.next_siblings[x];
+        MD_u32 tag_count = 0;
+        for(MD_EachFrozenTag(tag, &tree, w))
+        {
+            tag_count += 1;
+        }
+        TestResult(w == 6 && tag_count == 2 && tree.first_children[w] == 0);
+        
+        MD_u32 indices[16];
+        TestResult(MD_FrozenIndicesFromKind(&tree, 0, (MD_u32)tree.count, MD_NodeKind_Tag, indices) == 3);
+        TestResult(indices[0] == 2 && indices[1] == 7 && indices[2] == 8);
+        MD_u64 string_count = MD_FrozenIndicesFromFlags(&tree, 0, (MD_u32)tree.count,
+                                                        MD_NodeFlag_StringLiteral, indices);
+        TestResult(string_count == 1 && MD_S8Match(MD_StringFromFrozenNode(&tree, indices[0]), MD_S8Lit("z"), 0));
+        MD_u32 set = tree.next_siblings[w];
+        MD_u64 brackets = MD_FrozenIndicesFromFlags(&tree, set, set + tree.subtree_sizes[set],
+                                                  MD_NodeFlag_HasBracketLeft, indices);
+        TestResult(brackets == 1 && indices[0] == set && tree.next_siblings[set] == 0);
+        TestResult(MD_FreezeTree(MD_NilNode()).count == 0);
+    }
+    
+    Test("Node Side Tables")
+    {
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("raw_text"), MD_S8Lit("a: { b c } d"));
+        MD_Node *a = parse.node->first_child;
+        MD_Node *b = a->first_child;
+        MD_Node *d = a->next;
+        TestResult(MD_NilNode()->id == 0 && a->id != 0 && b->id != 0 && a->id != b->id && parse.node->id != a->id);
+        
+        MD_NodeTable table = MD_MakeNodeTable(sizeof(MD_u64));
+        TestResult(MD_NodeTableLookup(&table, a) == 0);
+        *(MD_u64 *)MD_NodeTableSlotFromNode(&table, a) = 1;
+        *(MD_u64 *)MD_NodeTableSlotFromNode(&table, d) = 4;
+        TestResult(*(MD_u64 *)MD_NodeTableLookup(&table, a) == 1 && *(MD_u64 *)MD_NodeTableLookup(&table, b) == 0);
+        TestResult(*(MD_u64 *)MD_NodeTableSlotFromNode(&table, d) == 4);
+        TestResult(MD_NodeTableLookup(&table, MD_NilNode()) == 0);
+        *(MD_u64 *)MD_NodeTableSlotFromNode(&table, MD_NilNode()) = 9;
+        TestResult(*(MD_u64 *)MD_NodeTableSlotFromNode(&table, MD_NilNode()) == 0);
+        
+        for(int i = 0; i < 2*MD_NODE_TABLE_PAGE_SIZE; i += 1)
+        {
+            MD_MakeNode(MD_NodeKind_Main, MD_S8Lit(""), MD_S8Lit(""), 0);
+        }
+        MD_Node *late = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("late"), MD_S8Lit("late"), 0);
+        *(MD_u64 *)MD_NodeTableSlotFromNode(&table, late) = 7;
+        TestResult(*(MD_u64 *)MD_NodeTableLookup(&table, late) == 7 && *(MD_u64 *)MD_NodeTableLookup(&table, a) == 1);
+        
+        MD_ParseResult copy = MD_ParseResultFromBinary(MD_BinaryFromParseResult(parse));
+        TestResult(copy.node->first_child->id != 0 && copy.node->first_child->id != a->id);
+        TestResult(*(MD_u64 *)MD_NodeTableSlotFromNode(&table, copy.node->first_child) == 0);
+    }
+    
+    Test("Structural Hashes")
+    {
+        MD_Node *a = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("@t(1) x: { y, Z/w }")).node;
+        MD_Node *b = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("@t(2) x: { y; z\\w }")).node;
+        MD_Node *c = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("x: { y, Z/w, v }")).node;
+        MD_MatchFlags loose = MD_StringMatchFlag_CaseInsensitive|MD_StringMatchFlag_SlashInsensitive;
+        TestResult(MD_NodeStructuralHash(a, 0) != MD_NodeStructuralHash(b, 0));
+        TestResult(MD_NodeStructuralHash(a, loose) == MD_NodeStructuralHash(b, loose));
+        TestResult(MD_NodeStructuralHash(a, loose|MD_NodeMatchFlag_Tags) ==
+                   MD_NodeStructuralHash(b, loose|MD_NodeMatchFlag_Tags));
+        TestResult(MD_NodeStructuralHash(a, loose|MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments) !=
+                   MD_NodeStructuralHash(b, loose|MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        TestResult(MD_NodeStructuralHash(a, MD_NodeMatchFlag_TagArguments) == MD_NodeStructuralHash(a, 0));
+        TestResult(MD_NodeStructuralHash(MD_NilNode(), 0) == MD_NodeStructuralHash(MD_NilNode(), 0));
+        
+        TestResult(!MD_NodeDeepMatch(a, b, 0) && MD_NodeDeepMatch(a, b, loose));
+        TestResult(MD_NodeDeepMatch(a, b, loose|MD_NodeMatchFlag_Tags));
+        TestResult(!MD_NodeDeepMatch(a, b, loose|MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments));
+        TestResult(!MD_NodeDeepMatch(a, c, 0) && MD_NodeDeepMatch(a->first_child->first_child, c->first_child->first_child, 0));
+        
+        MD_u64 old_hash = MD_NodeStructuralHash(a, 0);
+        MD_PushChild(a->first_child, MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("v"), MD_S8Lit("v"), 0));
+        TestResult(a->structural_hash_key == 0 && MD_NodeStructuralHash(a, 0) != old_hash);
+        TestResult(MD_NodeStructuralHash(a, 0) == MD_NodeStructuralHash(c, 0) && MD_NodeDeepMatch(a, c, 0));
+        MD_PushTag(c->first_child, MD_MakeNode(MD_NodeKind_Tag, MD_S8Lit("t"), MD_S8Lit("t"), 0));
+        TestResult(MD_NodeDeepMatch(a, c, MD_NodeMatchFlag_Tags));
+        
+        MD_MatchFlags tag_flags = MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments;
+        MD_Node *d = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("@t(1) x")).node;
+        MD_Node *e = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("@t(1, 2) x")).node;
+        TestResult(MD_NodeStructuralHash(d, tag_flags) != MD_NodeStructuralHash(e, tag_flags));
+        MD_PushChild(d->first_child->first_tag, MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("2"), MD_S8Lit("2"), 0));
+        TestResult(MD_NodeStructuralHash(d, tag_flags) == MD_NodeStructuralHash(e, tag_flags));
+        TestResult(MD_NodeDeepMatch(d, e, tag_flags));
+    }
+    
+    Test("Tree Diffs")
+    {
+        MD_Node *old_root = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: 1\nb: { x y }\nc\nd\ne: 5\n")).node;
+        MD_Node *new_root = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: 1\ne: 5\nb: { x z }\nd\nf\n")).node;
+        MD_TreeEditList edits = MD_TreeDiff(old_root, new_root, MD_NodeMatchFlag_Tags);
+        MD_String8List strings = {0};
+        for(MD_TreeEdit *edit = edits.first; edit != 0; edit = edit->next)
+        {
+            char *kinds[] = { "insert", "delete", "update", "move" };
+            MD_Node *node = MD_NodeIsNil(edit->new_node) ? edit->old_node : edit->new_node;
+            MD_S8ListPush(&strings, MD_S8Fmt("%s %.*s", kinds[edit->kind], MD_S8VArg(node->string)));
+        }
+        MD_StringJoin join = MD_ZERO_STRUCT;
+        join.mid = MD_S8Lit(", ");
+        MD_String8 script = MD_S8ListJoin(strings, &join);
+        TestResult(MD_S8Match(script, MD_S8Lit("delete c, move e, update b, delete y, insert z, insert f"), 0));
+        TestResult(edits.node_count == 6);
+        
+        TestResult(MD_TreeDiff(old_root, old_root, 0).node_count == 0);
+        MD_Node *tagged = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: 1\n@t b: { x y }\nc\nd\ne: 5\n")).node;
+        TestResult(MD_TreeDiff(old_root, tagged, 0).node_count == 0);
+        edits = MD_TreeDiff(old_root, tagged, MD_NodeMatchFlag_Tags);
+        TestResult(edits.node_count == 1 && edits.first->kind == MD_TreeEditKind_Update &&
+                   edits.first->old_node->parent == old_root);
+        
+        MD_Node *dupes = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a a a")).node;
+        MD_Node *fewer = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a a")).node;
+        edits = MD_TreeDiff(dupes, fewer, 0);
+        TestResult(edits.node_count == 1 && edits.first->kind == MD_TreeEditKind_Delete &&
+                   edits.first->old_node == dupes->last_child);
+    }
+    
+    Test("Persistent Trees")
+    {
+        MD_MatchFlags flags = MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments;
+        MD_Node *v0 = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: { b c } @t(1) d: { e } f")).node;
+        MD_Node *a = v0->first_child;
+        MD_Node *d = a->next;
+        MD_Node *x = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("x"), MD_S8Lit("x"), 0);
+        MD_Node *v1 = MD_PersistentInsertChild(v0, a, a->first_child, x);
+        MD_Node *expect = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: { b x c } @t(1) d: { e } f")).node;
+        TestResult(v1 != v0 && MD_NodeDeepMatch(v1, expect, flags));
+        TestResult(MD_NodeDeepMatch(v0, MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: { b c } @t(1) d: { e } f")).node, flags));
+        TestResult(v1->first_child != a && v1->first_child->id == a->id && v1->first_child->child_count == 3);
+        TestResult(x->index == 1 && v1->first_child->last_child->prev == x && a->first_child->next->next == MD_NilNode());
+        TestResult(v1->first_child->next->first_child == d->first_child);
+        
+        MD_Node *v2 = MD_PersistentRemove(v1, d->first_child);
+        MD_Node *u = MD_MakeNode(MD_NodeKind_Tag, MD_S8Lit("u"), MD_S8Lit("u"), 0);
+        MD_Node *v3 = MD_PersistentInsertTag(v2, v2->last_child, MD_NilNode(), u);
+        MD_Node *w = MD_MakeNode(MD_NodeKind_Tag, MD_S8Lit("w"), MD_S8Lit("w"), 0);
+        MD_Node *v4 = MD_PersistentReplace(v3, d->first_tag, w);
+        expect = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("a: { b x c } @w d @u f")).node;
+        TestResult(MD_NodeDeepMatch(v4, expect, flags) && MD_NodeHasTag(v4->last_child, MD_S8Lit("u"), 0));
+        TestResult(MD_NodeDeepMatch(v3->first_child->next, MD_ParseOneNode(MD_S8Lit("@t(1) d"), 0).node, flags));
+        TestResult(v4->first_child->first_child == v1->first_child->first_child);
+        
+        MD_Node *v5 = MD_PersistentRemove(v4, MD_TagArgFromIndex(d, MD_S8Lit("t"), 0, 0));
+        TestResult(v5 == v4 && MD_PersistentRemove(v0, x) == v0);
+        MD_Node *v6 = MD_PersistentRemove(v3, MD_TagArgFromIndex(d, MD_S8Lit("t"), 0, 0));
+        TestResult(MD_NodeDeepMatch(v6->first_child->next, MD_ParseOneNode(MD_S8Lit("@t() d"), 0).node, flags));
+        
+        MD_Node *deep_root = MD_MakeList();
+        MD_Node *deepest = deep_root;
+        for(int i = 0; i < 1000; i += 1)
+        {
+            MD_Node *child = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("n"), MD_S8Lit("n"), 0);
+            MD_PushChild(deepest, child);
+            deepest = child;
+        }
+        MD_Node *y = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("y"), MD_S8Lit("y"), 0);
+        MD_Node *deep_v1 = MD_PersistentInsertChild(deep_root, deepest, MD_NilNode(), y);
+        MD_Node *deep_copy = deep_v1;
+        for(int i = 0; i < 1000; i += 1)
+        {
+            deep_copy = deep_copy->first_child;
+        }
+        TestResult(deep_v1 != deep_root && deep_copy->id == deepest->id && deep_copy->first_child == y);
+    }
+    
+    Test("Hot Reload")
+    {
+        MD_String8 file_name = MD_S8Lit("__hot_reload_test.mdesk");
+        MD_WriteEntireFile(file_name, MD_S8Lit("a b"));
+        int retired_count = 0;
+        MD_HotReload *reload = MD_MakeHotReload(file_name, 0, 2);
+        reload->retire_callback = CountRetiredVersion;
+        reload->retire_user_data = &retired_count;
+        MD_Node *old_root = MD_HotReloadBeginRead(reload, 0);
+        TestResult(MD_ChildCountFromNode(old_root) == 2 && !MD_HotReloadPoll(reload));
+        
+        MD_WriteEntireFile(file_name, MD_S8Lit("a b c"));
+        TestResult(MD_HotReloadPoll(reload) && retired_count == 0);
+        MD_Node *new_root = MD_HotReloadBeginRead(reload, 1);
+        TestResult(MD_ChildCountFromNode(new_root) == 3 && MD_ChildCountFromNode(old_root) == 2);
+        MD_HotReloadEndRead(reload, 0);
+        TestResult(!MD_HotReloadPoll(reload) && retired_count == 1);
+        
+        TestResult(!MD_HotReloadPublishString(reload, MD_S8Lit("a: ]")) && reload->errors.node_count != 0);
+        TestResult(MD_HotReloadBeginRead(reload, 0) == new_root);
+        MD_HotReloadEndRead(reload, 0);
+        
+        MD_String8 wide_text = MD_S8Lit("w: {a b c d e f g h i j k l m n o p q r s t u v w x y z A B C D E F G H I J}\n"
+                                        "x: {a b}");
+        TestResult(MD_HotReloadPublishString(reload, wide_text));
+        MD_Node *wide_root = MD_HotReloadBeginRead(reload, 0);
+        MD_Node *wide = wide_root->first_child;
+        MD_Node *d = MD_ChildFromString(wide, MD_S8Lit("d"), 0);
+        TestResult(wide->accel != 0);
+        TestResult(MD_ChildFromIndex(wide, 3) == d && MD_S8Match(d->string, MD_S8Lit("d"), 0));
+        TestResult(MD_CodeLocFromNode(wide->next).line == 2);
+        TestResult(!MD_NodeDeepMatch(wide, wide->next, 0) && wide->structural_hash_key == 0);
+        MD_Node **small_array = MD_ChildArrayFromNode(wide->next);
+        TestResult(small_array[1] == wide->next->last_child && MD_ChildArrayFromNode(wide->next) == small_array);
+        MD_HotReloadEndRead(reload, 0);
+        MD_HotReloadEndRead(reload, 1);
+        remove((char *)file_name.str);
+    }
+    
+    Test("Deep Copy")
+    {
+        MD_MatchFlags flags = MD_NodeMatchFlag_Tags|MD_NodeMatchFlag_TagArguments;
+        MD_String8 text = MD_S8Lit("// a comment\n@t(x) a: { b \"c d\" e: (f) } g");
+        MD_Node *root = MD_ParseWholeString(MD_S8Lit("f"), text).node;
+        MD_Node *a = root->first_child;
+        MD_Node *copy = MD_NodeDeepCopy(a);
+        TestResult(copy != a && MD_NodeDeepMatch(copy, a, flags) && copy->id != a->id);
+        TestResult(MD_NodeIsNil(copy->parent) && MD_NodeIsNil(copy->next) && copy->first_tag->parent == copy);
+        TestResult(copy->first_tag == copy + 1 && copy->first_child == copy + 3);
+        TestResult(MD_S8Match(copy->prev_comment, MD_S8Lit(" a comment"), 0) &&
+                   copy->prev_comment.str != a->prev_comment.str);
+        MD_Node *quoted = copy->first_child->next;
+        TestResult(MD_S8Match(quoted->string, MD_S8Lit("c d"), 0) &&
+                   quoted->string.str == quoted->raw_string.str + 1);
+        MD_PushChild(a, MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("h"), MD_S8Lit("h"), 0));
+        TestResult(copy->child_count == 3 && a->child_count == 4);
+        
+        MD_Node *list = MD_MakeList();
+        MD_Node *inner = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("i"), MD_S8Lit("i"), 0);
+        MD_PushChild(list, inner);
+        MD_PushNewReference(list, inner);
+        MD_PushNewReference(list, root);
+        MD_Node *list_copy = MD_NodeDeepCopy(list);
+        TestResult(list_copy->first_child->next->ref_target == list_copy->first_child);
+        TestResult(list_copy->last_child->ref_target == root);
+        
+        MD_Node *g = a->next;
+        MD_Node *compact = MD_TreeCompact(a);
+        TestResult(compact != a && compact->id == a->id && MD_NodeDeepMatch(compact, a, flags));
+        TestResult(root->first_child == compact && compact->next == g && g->prev == compact);
+        TestResult(compact->parent == root && compact->first_child->parent == compact);
+        
+        MD_String8 wide_text = MD_S8Lit("a b c d e f g h i j k l m n o p q r s t u v w x y z A B C D E F G H I J");
+        MD_Node *wide = MD_ParseWholeString(MD_S8Lit("f"), wide_text).node;
+        MD_Node *d = MD_ChildFromIndex(wide, 3);
+        TestResult(wide->child_count == 36 && MD_ChildFromString(wide, MD_S8Lit("d"), 0) == d);
+        MD_Node *d_compact = MD_TreeCompact(d);
+        TestResult(MD_ChildFromIndex(wide, 3) == d_compact);
+        TestResult(MD_ChildFromString(wide, MD_S8Lit("d"), 0) == d_compact);
+    }
+    
+    Test("Source Ranges")
+    {
+        MD_String8 text = MD_S8Lit("// c\n@t(x, y) a: { b \"c d\" e: (f g), } h: i j\nk: l;\n(n o) p: [q\n");
+        MD_ParseResult parse = MD_ParseWholeString(MD_S8Lit("f"), text);
+        MD_Node *a = parse.node->first_child;
+        MD_Node *e = a->last_child;
+        MD_Node *h = a->next;
+        MD_Node *k = h->next;
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(parse.node), text, 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(a), MD_S8Lit("@t(x, y) a: { b \"c d\" e: (f g), }"), 0));
+        TestResult(MD_SourceRangeFromNode(a).str == text.str + 5);
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(a->first_tag), MD_S8Lit("@t(x, y)"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(e), MD_S8Lit("e: (f g)"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(e->first_child->next), MD_S8Lit("g"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(h), MD_S8Lit("h: i j"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(k), MD_S8Lit("k: l"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(k->next), MD_S8Lit("(n o)"), 0));
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(k->next->next), MD_S8Lit("p: [q"), 0));
+        
+        MD_ParseOptions options = MD_ZERO_STRUCT;
+        options.flags = MD_ParseFlag_LazySets;
+        MD_Node *lazy = MD_ParseWholeStringWithOptions(MD_S8Lit("f"), MD_S8Lit("a: {b {c}} d"), &options).node;
+        TestResult(MD_S8Match(MD_SourceRangeFromNode(lazy->first_child), MD_S8Lit("a: {b {c}}"), 0));
+        MD_Node *made = MD_MakeNode(MD_NodeKind_Main, MD_S8Lit("m"), MD_S8Lit("m"), 0);
+        TestResult(MD_SourceRangeFromNode(made).size == 0);
+    }
+    
+    Test("Node Arrays")
+    {
+        MD_Node *root = MD_ParseWholeString(MD_S8Lit("f"), MD_S8Lit("ccc @x a bb @x dd e @x fff")).node;
+        MD_NodeArray children = MD_NodeArrayFromChildren(root);
+        TestResult(children.count == 6 && children.v[0] == root->first_child && children.v[5] == root->last_child);
+        
+        MD_NodeArray sorted = MD_NodeArraySort(children, NodeStringSizeKey, 0);
+        MD_String8List strings = MD_ZERO_STRUCT;
+        for(MD_EachNodeInArray(node, sorted))
+        {
+            MD_S8ListPush(&strings, node->string);
+        }
+        TestResult(MD_S8Match(MD_S8ListJoin(strings, 0), MD_S8Lit("aebbddcccfff"), 0));
+        TestResult(children.v[0] == root->first_child);
+        
+        MD_String8 tag = MD_S8Lit("x");
+        MD_NodeArray tagged = MD_NodeArrayFilter(children, NodeHasTagFilter, &tag);
+        MD_NodeArray untagged = MD_NodeArrayDifference(children, tagged);
+        TestResult(tagged.count == 3 && untagged.count == 3 && untagged.v[0] == children.v[0]);
+        MD_NodeArray merged = MD_NodeArrayMerge(MD_NodeArraySort(tagged, NodeStringSizeKey, 0),
+                                                MD_NodeArraySort(untagged, NodeStringSizeKey, 0),
+                                                NodeStringSizeKey, 0);
+        TestResult(merged.count == 6 && merged.v[0]->string.size == 1 && merged.v[5]->string.size == 3);
+        TestResult(MD_S8Match(merged.v[2]->string, MD_S8Lit("dd"), 0) && MD_S8Match(merged.v[3]->string, MD_S8Lit("bb"), 0));
+        
+        MD_NodeArray both = MD_NodeArrayUnion(tagged, children);
+        TestResult(both.count == 6 && both.v[0] == tagged.v[0] && both.v[3] == children.v[0]);
+        TestResult(MD_NodeArrayIntersect(children, tagged).count == 3);
+        MD_NodeArray doubled = MD_NodeArrayCopy(children);
+        for(MD_EachNodeInArray(node, children))
+        {
+            MD_NodeArrayPush(&doubled, node);
+        }
+        MD_NodeArray unique = MD_NodeArrayUnique(doubled);
+        TestResult(doubled.count == 12 && unique.count == 6 && unique.v[5] == children.v[5]);
+        
+        MD_Node *list = MD_MakeList();
+        MD_PushNewReference(list, children.v[1]);
+        MD_PushNewReference(list, children.v[3]);
+        MD_NodeArray targets = MD_NodeArrayFromReferences(list);
+        TestResult(targets.count == 2 && targets.v[1] == children.v[3]);
+        TestResult(MD_NodeArrayFromTags(children.v[1]).count == 1);
+    }
+    
+    Test("Sorting")
+    {
+        MD_String8 text = MD_S8Lit("@order(300) b @order(2) abc @order(70000) ab @order(2) a @order(5) b2 @order(1) \"\"");
+        MD_Node *root = MD_ParseWholeString(MD_S8Lit("f"), text).node;
+        MD_NodeArray by_string = MD_NodeArraySortByString(MD_NodeArrayFromChildren(root), NodeStringKey, 0);
+        MD_String8List strings = MD_ZERO_STRUCT;
+        for(MD_EachNodeInArray(node, by_string))
+        {
+            MD_S8ListPush(&strings, node->string);
+            MD_S8ListPush(&strings, MD_S8Lit(","));
+        }
+        TestResult(MD_S8Match(MD_S8ListJoin(strings, 0), MD_S8Lit(",a,ab,abc,b,b2,"), 0));
+        
+        MD_SortChildren(root, NodeTagArgKey, 0);
+        MD_String8List order = MD_ZERO_STRUCT;
+        MD_Node *prev = MD_NilNode();
+        MD_b32 links_good = 1;
+        for(MD_EachNode(child, root->first_child))
+        {
+            MD_S8ListPush(&order, child->string);
+            MD_S8ListPush(&order, MD_S8Lit(","));
+            links_good = links_good && child->prev == prev && child->index == (MD_u64)MD_IndexFromNode(child);
+            prev = child;
+        }
+        TestResult(MD_S8Match(MD_S8ListJoin(order, 0), MD_S8Lit(",abc,a,b2,b,ab,"), 0));
+        TestResult(links_good && root->last_child == prev && MD_S8Match(prev->string, MD_S8Lit("ab"), 0));
+        TestResult(MD_ChildFromIndex(root, 1) == root->first_child->next);
+        
+        MD_Node *many = MD_MakeList();
+        for(int i = 0; i < 2000; i += 1)
+        {
+            MD_String8 string = MD_S8Fmt("%c%d", 'a' + (i*7)%3, (i*7919)%500);
+            MD_PushChild(many, MD_MakeNode(MD_NodeKind_Main, string, string, (MD_u64)i));
+        }
+        MD_ChildFromString(many, MD_S8Lit("a0"), 0);
+        MD_SortChildrenByString(many, NodeStringKey, 0);
+        MD_b32 sorted = 1;
+        for(MD_Node *child = many->first_child->next; !MD_NodeIsNil(child); child = child->next)
+        {
+            MD_String8 a = child->prev->string;
+            MD_String8 b = child->string;
+            int cmp = memcmp(a.str, b.str, a.size < b.size ? a.size : b.size);
+            cmp = cmp ? cmp : (a.size > b.size) - (a.size < b.size);
+            sorted = sorted && (cmp < 0 || (cmp == 0 && child->prev->offset < child->offset));
+        }
+        TestResult(sorted && many->child_count == 2000);
+        TestResult(MD_ChildFromString(many, MD_S8Lit("a0"), 0) == many->first_child);
+    }
+    
     return 0;
 }